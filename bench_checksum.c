@@ -0,0 +1,61 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "checksum.h"
+
+/* ******************************************************************
+   Throughput of the checksum engines.
+
+     gcc -Wall -O2 bench_checksum.c checksum.c -o bench_checksum
+     ./bench_checksum [seconds per measurement]
+
+   Every engine sums buffers of the packet payload size and of larger
+   sizes for a while and reports nanoseconds per buffer and MB/s.
+**********************************************************************/
+
+static const size_t sizes[] = { 20, 64, 256, 1500, 9000, 65536 };
+
+static double wallclock(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+  double seconds = argc > 1 ? atof(argv[1]) : 0.2;
+  double start, elapsed;
+  unsigned char *buf;
+  volatile uint32_t sink = 0;
+  size_t i, n, maxsize = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+  long iters, k;
+  int e;
+
+  buf = malloc(maxsize);
+  if (buf == NULL) {
+    printf("memory allocation for benchmark failed.");
+    return EXIT_FAILURE;
+  }
+  for (i = 0; i < maxsize; i++)
+    buf[i] = (unsigned char)(i * 131 + 7);
+
+  printf("%-12s %8s %12s %12s\n", "engine", "bytes", "ns/buffer", "MB/s");
+  for (e = 0; e < CHECKSUM_ENGINES; e++)
+    for (n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++) {
+      /* double the iterations until a measurement takes long enough */
+      for (iters = 1024; ; iters *= 2) {
+        start = wallclock();
+        for (k = 0; k < iters; k++)
+          sink += checksum_bytes(e, buf, sizes[n]);
+        elapsed = wallclock() - start;
+        if (elapsed >= seconds)
+          break;
+      }
+      printf("%-12s %8lu %12.2f %12.1f\n", checksum_name(e), (unsigned long)sizes[n],
+             elapsed * 1e9 / iters, sizes[n] * (double)iters / elapsed / 1e6);
+    }
+  free(buf);
+  return sink == 0xdeadbeef ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "emulator.h"
+#include "cc.h"
+
+/* ******************************************************************
+   Congestion control, see cc.h.
+**********************************************************************/
+
+#define CUBIC_C    0.4     /* growth of the cubic curve, packets per round trip^3 */
+#define CUBIC_BETA 0.7     /* cwnd after a loss, as a fraction of wmax */
+#define MINSSTHRESH 2.0
+
+static const char *names[] = { "none", "reno", "cubic" };
+
+int cc_kind(const char *name)
+{
+  int i;
+
+  for (i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++)
+    if (strcmp(names[i], name) == 0)
+      return i;
+  return -1;
+}
+
+const char *cc_name(int kind)
+{
+  return names[kind];
+}
+
+static void cc_log(struct sim *s, const struct cc *c)
+{
+  if (s->cwndlog != NULL)
+    fprintf(s->cwndlog, "%.4f,%.4f,%.4f\n", simtime(s), c->cwnd, c->ssthresh);
+}
+
+void cc_init(struct sim *s, struct cc *c, int kind, int maxwindow)
+{
+  c->kind = kind;
+  c->maxwindow = maxwindow;
+  c->cwnd = kind == CC_NONE ? maxwindow : 1.0;
+  c->ssthresh = maxwindow;
+  c->unit = s->cfg.rtt;
+  c->wmax = 0.0;
+  c->epoch = -1.0;
+  c->k = 0.0;
+  if (kind != CC_NONE)
+    cc_log(s, c);
+}
+
+/* cwnd to aim for one round trip from now on the cubic curve, or where
+   reno would be if that is more (the TCP friendly region) */
+static double cubic_target(const struct sim *s, struct cc *c)
+{
+  double t, w, reno;
+
+  if (c->epoch < 0.0) {
+    /* no loss yet: grow from here as if this were the plateau */
+    c->epoch = simtime(s);
+    c->wmax = c->cwnd;
+    c->k = 0.0;
+  }
+  t = (simtime(s) - c->epoch) / c->unit;
+  w = CUBIC_C * pow(t + 1.0 - c->k, 3) + c->wmax;
+  reno = c->wmax * CUBIC_BETA + 3.0 * (1.0 - CUBIC_BETA) / (1.0 + CUBIC_BETA) * t;
+  return fmax(w, reno);
+}
+
+void cc_ack(struct sim *s, struct cc *c, int acked)
+{
+  double target;
+
+  if (c->kind == CC_NONE)
+    return;
+  for (; acked > 0; acked--) {
+    if (c->cwnd < c->ssthresh)
+      c->cwnd += 1.0;
+    else if (c->kind == CC_RENO)
+      c->cwnd += 1.0 / c->cwnd;
+    else {
+      target = cubic_target(s, c);
+      if (target > c->cwnd)
+        c->cwnd += (target - c->cwnd) / c->cwnd;
+      else
+        c->cwnd += 0.01 / c->cwnd;
+    }
+  }
+  /* beyond the fixed window cwnd could grow without ever being tested */
+  c->cwnd = fmin(c->cwnd, c->maxwindow);
+  cc_log(s, c);
+}
+
+/* multiplicative decrease, returns the new cwnd */
+static double cc_reduce(const struct sim *s, struct cc *c)
+{
+  if (c->kind == CC_RENO)
+    return fmax(c->cwnd / 2.0, MINSSTHRESH);
+  /* fast convergence: give way to newer flows when losing ground */
+  c->wmax = c->cwnd < c->wmax ? c->cwnd * (1.0 + CUBIC_BETA) / 2.0 : c->cwnd;
+  c->k = cbrt(c->wmax * (1.0 - CUBIC_BETA) / CUBIC_C);
+  c->epoch = simtime(s);
+  return fmax(c->cwnd * CUBIC_BETA, MINSSTHRESH);
+}
+
+void cc_timeout(struct sim *s, struct cc *c)
+{
+  if (c->kind == CC_NONE)
+    return;
+  c->ssthresh = cc_reduce(s, c);
+  c->cwnd = 1.0;
+  cc_log(s, c);
+}
+
+void cc_loss(struct sim *s, struct cc *c)
+{
+  if (c->kind == CC_NONE)
+    return;
+  c->cwnd = c->ssthresh = cc_reduce(s, c);
+  cc_log(s, c);
+}
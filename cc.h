@@ -0,0 +1,66 @@
+#ifndef CC_H
+#define CC_H
+
+/* ******************************************************************
+   Congestion control.
+
+   With --cc reno or --cc cubic the sender keeps a congestion window
+   (cwnd, in packets) alongside its fixed window, and only sends while
+   fewer than the smaller of the two are outstanding.  cwnd starts at
+   one packet and grows by one per new ACK (slow start) until it reaches
+   ssthresh, then by about one per window of ACKs (reno) or along the
+   CUBIC curve around the window of the last loss, with time measured
+   in units of --rtt.  A timeout sets ssthresh to half the window and
+   cwnd back to one; a loss signalled by duplicate ACKs (a GBN fast
+   retransmit, or CC_DUPSACKS SR SACKs that do not move the window)
+   halves cwnd (reno) or cuts it to 0.7 of itself (cubic) once per
+   window.  With --cc none (the default) cwnd is the fixed window.
+
+   With --cwnd-log FILE every change of cwnd is written to FILE as
+   "time,cwnd,ssthresh" CSV rows.
+**********************************************************************/
+
+struct sim;
+
+/* simconfig.cc */
+#define CC_NONE   0
+#define CC_RENO   1
+#define CC_CUBIC  2
+
+#define CC_DUPSACKS 3          /* SACKs without progress that signal a loss */
+
+struct cc {
+  int kind;                /* CC_* */
+  int maxwindow;           /* the fixed window, cwnd never exceeds it */
+  double cwnd;             /* congestion window in packets */
+  double ssthresh;         /* slow start below this */
+  double unit;             /* cubic: time of one round trip (--rtt) */
+  double wmax;             /* cubic: cwnd before the last reduction */
+  double epoch;            /* cubic: when it started growing again, -1 for not yet */
+  double k;                /* cubic: time to grow back to wmax, in round trips */
+};
+
+/* name of a CC_* kind and back, -1 for an unknown name */
+extern int cc_kind(const char *name);
+extern const char *cc_name(int kind);
+
+extern void cc_init(struct sim *, struct cc *, int kind, int maxwindow);
+
+/* packets that may be outstanding */
+static inline int cc_window(const struct cc *c)
+{
+  if (c->kind == CC_NONE || c->cwnd >= c->maxwindow)
+    return c->maxwindow;
+  return (int)c->cwnd;
+}
+
+/* acked new packets were acknowledged */
+extern void cc_ack(struct sim *, struct cc *, int acked);
+
+/* the retransmission timer went off */
+extern void cc_timeout(struct sim *, struct cc *);
+
+/* duplicate ACKs signalled a lost packet */
+extern void cc_loss(struct sim *, struct cc *);
+
+#endif
@@ -0,0 +1,312 @@
+#include <string.h>
+#include "checksum.h"
+
+/* ******************************************************************
+   Checksum engines, see checksum.h.
+
+   Every engine is an update function that carries a 32 bit state
+   from one piece of data to the next, so a packet is summed in place
+   (header fields, then payload) without copying it.  Pieces must have
+   an even length, except the last one.
+**********************************************************************/
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <nmmintrin.h>
+#define HAVE_SSE42_CRC 1
+#ifdef __x86_64__
+#include <wmmintrin.h>
+#define HAVE_PCLMUL_CRC 1
+#endif
+#endif
+
+struct engine {
+  const char *name;
+  uint32_t init;
+  uint32_t (*update)(uint32_t state, const unsigned char *p, size_t len);
+  uint32_t (*final)(uint32_t state);
+};
+
+/********************* legacy ***********************/
+
+/* payload bytes are added as (signed) char, as the original did */
+static uint32_t legacy_update(uint32_t state, const unsigned char *p, size_t len)
+{
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    state += (uint32_t)(int)(char)p[i];
+  return state;
+}
+
+static uint32_t identity(uint32_t state)
+{
+  return state;
+}
+
+/********************* internet ***********************/
+
+/* The ones' complement sum does not depend on byte order (RFC 1071),
+   so 16 bit words are added in host order, eight bytes at a time into
+   a 64 bit accumulator, and the result is swapped at the end on little
+   endian machines.  The state is the running sum folded to 16 bits. */
+static uint32_t fold16(uint64_t sum)
+{
+  while (sum >> 16)
+    sum = (sum & 0xffff) + (sum >> 16);
+  return (uint32_t)sum;
+}
+
+static uint32_t internet_update(uint32_t state, const unsigned char *p, size_t len)
+{
+  uint64_t sum = state, w;
+  uint16_t h;
+  unsigned char last[2];
+
+  for (; len >= 8; p += 8, len -= 8) {
+    memcpy(&w, p, 8);
+    sum += (w & 0xffffffffu) + (w >> 32);
+  }
+  for (; len >= 2; p += 2, len -= 2) {
+    memcpy(&h, p, 2);
+    sum += h;
+  }
+  if (len == 1) {                 /* pad the odd byte with zero */
+    last[0] = *p;
+    last[1] = 0;
+    memcpy(&h, last, 2);
+    sum += h;
+  }
+  return fold16(sum);
+}
+
+static uint32_t internet_final(uint32_t state)
+{
+  const uint16_t one = 1;
+  uint32_t sum = ~state & 0xffff;
+
+  if (*(const unsigned char *)&one)     /* little endian */
+    sum = ((sum & 0xff) << 8) | (sum >> 8);
+  return sum;
+}
+
+/********************* fletcher32 ***********************/
+
+/* sum1 in the low and sum2 in the high half of the state; both can
+   take 359 words before they would overflow 32 bits */
+static uint32_t fletcher32_update(uint32_t state, const unsigned char *p, size_t len)
+{
+  uint32_t sum1 = state & 0xffff, sum2 = state >> 16;
+  size_t words = len / 2, block, i;
+
+  while (words > 0) {
+    block = words < 359 ? words : 359;
+    words -= block;
+    for (i = 0; i < block; i++, p += 2) {
+      sum1 += p[0] | (uint32_t)p[1] << 8;
+      sum2 += sum1;
+    }
+    sum1 %= 65535;
+    sum2 %= 65535;
+  }
+  if (len & 1) {
+    sum1 = (sum1 + *p) % 65535;
+    sum2 = (sum2 + sum1) % 65535;
+  }
+  return sum2 << 16 | sum1;
+}
+
+/********************* crc32c ***********************/
+
+static const uint32_t crc32c_table[256] = {
+  0x00000000, 0xf26b8303, 0xe13b70f7, 0x1350f3f4, 0xc79a971f, 0x35f1141c,
+  0x26a1e7e8, 0xd4ca64eb, 0x8ad958cf, 0x78b2dbcc, 0x6be22838, 0x9989ab3b,
+  0x4d43cfd0, 0xbf284cd3, 0xac78bf27, 0x5e133c24, 0x105ec76f, 0xe235446c,
+  0xf165b798, 0x030e349b, 0xd7c45070, 0x25afd373, 0x36ff2087, 0xc494a384,
+  0x9a879fa0, 0x68ec1ca3, 0x7bbcef57, 0x89d76c54, 0x5d1d08bf, 0xaf768bbc,
+  0xbc267848, 0x4e4dfb4b, 0x20bd8ede, 0xd2d60ddd, 0xc186fe29, 0x33ed7d2a,
+  0xe72719c1, 0x154c9ac2, 0x061c6936, 0xf477ea35, 0xaa64d611, 0x580f5512,
+  0x4b5fa6e6, 0xb93425e5, 0x6dfe410e, 0x9f95c20d, 0x8cc531f9, 0x7eaeb2fa,
+  0x30e349b1, 0xc288cab2, 0xd1d83946, 0x23b3ba45, 0xf779deae, 0x05125dad,
+  0x1642ae59, 0xe4292d5a, 0xba3a117e, 0x4851927d, 0x5b016189, 0xa96ae28a,
+  0x7da08661, 0x8fcb0562, 0x9c9bf696, 0x6ef07595, 0x417b1dbc, 0xb3109ebf,
+  0xa0406d4b, 0x522bee48, 0x86e18aa3, 0x748a09a0, 0x67dafa54, 0x95b17957,
+  0xcba24573, 0x39c9c670, 0x2a993584, 0xd8f2b687, 0x0c38d26c, 0xfe53516f,
+  0xed03a29b, 0x1f682198, 0x5125dad3, 0xa34e59d0, 0xb01eaa24, 0x42752927,
+  0x96bf4dcc, 0x64d4cecf, 0x77843d3b, 0x85efbe38, 0xdbfc821c, 0x2997011f,
+  0x3ac7f2eb, 0xc8ac71e8, 0x1c661503, 0xee0d9600, 0xfd5d65f4, 0x0f36e6f7,
+  0x61c69362, 0x93ad1061, 0x80fde395, 0x72966096, 0xa65c047d, 0x5437877e,
+  0x4767748a, 0xb50cf789, 0xeb1fcbad, 0x197448ae, 0x0a24bb5a, 0xf84f3859,
+  0x2c855cb2, 0xdeeedfb1, 0xcdbe2c45, 0x3fd5af46, 0x7198540d, 0x83f3d70e,
+  0x90a324fa, 0x62c8a7f9, 0xb602c312, 0x44694011, 0x5739b3e5, 0xa55230e6,
+  0xfb410cc2, 0x092a8fc1, 0x1a7a7c35, 0xe811ff36, 0x3cdb9bdd, 0xceb018de,
+  0xdde0eb2a, 0x2f8b6829, 0x82f63b78, 0x709db87b, 0x63cd4b8f, 0x91a6c88c,
+  0x456cac67, 0xb7072f64, 0xa457dc90, 0x563c5f93, 0x082f63b7, 0xfa44e0b4,
+  0xe9141340, 0x1b7f9043, 0xcfb5f4a8, 0x3dde77ab, 0x2e8e845f, 0xdce5075c,
+  0x92a8fc17, 0x60c37f14, 0x73938ce0, 0x81f80fe3, 0x55326b08, 0xa759e80b,
+  0xb4091bff, 0x466298fc, 0x1871a4d8, 0xea1a27db, 0xf94ad42f, 0x0b21572c,
+  0xdfeb33c7, 0x2d80b0c4, 0x3ed04330, 0xccbbc033, 0xa24bb5a6, 0x502036a5,
+  0x4370c551, 0xb11b4652, 0x65d122b9, 0x97baa1ba, 0x84ea524e, 0x7681d14d,
+  0x2892ed69, 0xdaf96e6a, 0xc9a99d9e, 0x3bc21e9d, 0xef087a76, 0x1d63f975,
+  0x0e330a81, 0xfc588982, 0xb21572c9, 0x407ef1ca, 0x532e023e, 0xa145813d,
+  0x758fe5d6, 0x87e466d5, 0x94b49521, 0x66df1622, 0x38cc2a06, 0xcaa7a905,
+  0xd9f75af1, 0x2b9cd9f2, 0xff56bd19, 0x0d3d3e1a, 0x1e6dcdee, 0xec064eed,
+  0xc38d26c4, 0x31e6a5c7, 0x22b65633, 0xd0ddd530, 0x0417b1db, 0xf67c32d8,
+  0xe52cc12c, 0x1747422f, 0x49547e0b, 0xbb3ffd08, 0xa86f0efc, 0x5a048dff,
+  0x8ecee914, 0x7ca56a17, 0x6ff599e3, 0x9d9e1ae0, 0xd3d3e1ab, 0x21b862a8,
+  0x32e8915c, 0xc083125f, 0x144976b4, 0xe622f5b7, 0xf5720643, 0x07198540,
+  0x590ab964, 0xab613a67, 0xb831c993, 0x4a5a4a90, 0x9e902e7b, 0x6cfbad78,
+  0x7fab5e8c, 0x8dc0dd8f, 0xe330a81a, 0x115b2b19, 0x020bd8ed, 0xf0605bee,
+  0x24aa3f05, 0xd6c1bc06, 0xc5914ff2, 0x37faccf1, 0x69e9f0d5, 0x9b8273d6,
+  0x88d28022, 0x7ab90321, 0xae7367ca, 0x5c18e4c9, 0x4f48173d, 0xbd23943e,
+  0xf36e6f75, 0x0105ec76, 0x12551f82, 0xe03e9c81, 0x34f4f86a, 0xc69f7b69,
+  0xd5cf889d, 0x27a40b9e, 0x79b737ba, 0x8bdcb4b9, 0x988c474d, 0x6ae7c44e,
+  0xbe2da0a5, 0x4c4623a6, 0x5f16d052, 0xad7d5351
+};
+
+static uint32_t crc32c_table_update(uint32_t crc, const unsigned char *p, size_t len)
+{
+  while (len-- > 0)
+    crc = crc32c_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+  return crc;
+}
+
+#ifdef HAVE_SSE42_CRC
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42_update(uint32_t crc, const unsigned char *p, size_t len)
+{
+#ifdef __x86_64__
+  uint64_t w, c = crc;
+
+  for (; len >= 8; p += 8, len -= 8) {
+    memcpy(&w, p, 8);
+    c = _mm_crc32_u64(c, w);
+  }
+  crc = (uint32_t)c;
+#endif
+  for (; len > 0; p++, len--)
+    crc = _mm_crc32_u8(crc, *p);
+  return crc;
+}
+#endif
+
+#ifdef HAVE_PCLMUL_CRC
+/* Each crc32 instruction waits for the one before, three cycles on
+   current processors, while one can start every cycle.  So blocks of
+   3 * LANE bytes are summed as three independent lanes, the last two
+   from zero, and combined: by linearity the CRC of the block is that of
+   the first lane moved on over 2 * LANE zero bytes, plus that of the
+   second moved on over LANE, plus the third's.  Moving a CRC on over n
+   zero bytes multiplies it by x^8n mod P, one carry-less multiply and
+   one crc32 to reduce the product. */
+#define LANE 256
+#define X8LANE  0x88e56f72u        /* x^(8 * LANE) mod P, bit reflected */
+#define X16LANE 0x74c360a4u        /* x^(16 * LANE) mod P */
+
+__attribute__((target("sse4.2,pclmul")))
+static uint32_t crc32c_shift(uint32_t crc, uint32_t xn)
+{
+  __m128i prod = _mm_clmulepi64_si128(_mm_cvtsi32_si128((int)crc), _mm_cvtsi32_si128((int)xn), 0);
+  /* in bit reflected order the 63 bit product sits one bit too low */
+  uint64_t m = (uint64_t)_mm_cvtsi128_si64(prod) << 1;
+
+  return (uint32_t)_mm_crc32_u32(0, (uint32_t)m) ^ (uint32_t)(m >> 32);
+}
+
+__attribute__((target("sse4.2,pclmul")))
+static uint32_t crc32c_pclmul_update(uint32_t crc, const unsigned char *p, size_t len)
+{
+  uint64_t c0, c1, c2, w0, w1, w2;
+  size_t i;
+
+  for (; len >= 3 * LANE; p += 3 * LANE, len -= 3 * LANE) {
+    c0 = crc;
+    c1 = c2 = 0;
+    for (i = 0; i < LANE; i += 8) {
+      memcpy(&w0, p + i, 8);
+      memcpy(&w1, p + LANE + i, 8);
+      memcpy(&w2, p + 2 * LANE + i, 8);
+      c0 = _mm_crc32_u64(c0, w0);
+      c1 = _mm_crc32_u64(c1, w1);
+      c2 = _mm_crc32_u64(c2, w2);
+    }
+    crc = crc32c_shift((uint32_t)c0, X16LANE) ^ crc32c_shift((uint32_t)c1, X8LANE) ^ (uint32_t)c2;
+  }
+  return crc32c_sse42_update(crc, p, len);
+}
+#endif
+
+static uint32_t crc32c_update(uint32_t crc, const unsigned char *p, size_t len)
+{
+#ifdef HAVE_PCLMUL_CRC
+  if (len >= 3 * LANE && __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("pclmul"))
+    return crc32c_pclmul_update(crc, p, len);
+#endif
+#ifdef HAVE_SSE42_CRC
+  if (__builtin_cpu_supports("sse4.2"))
+    return crc32c_sse42_update(crc, p, len);
+#endif
+  return crc32c_table_update(crc, p, len);
+}
+
+static uint32_t crc32c_final(uint32_t crc)
+{
+  return crc ^ 0xffffffffu;
+}
+
+/********************* interface ***********************/
+
+static const struct engine engines[CHECKSUM_ENGINES] = {
+  { "legacy", 0, legacy_update, identity },
+  { "internet", 0, internet_update, internet_final },
+  { "fletcher32", 0, fletcher32_update, identity },
+  { "crc32c", 0xffffffffu, crc32c_update, crc32c_final }
+};
+
+int checksum_kind(const char *name)
+{
+  int i;
+
+  for (i = 0; i < CHECKSUM_ENGINES; i++)
+    if (strcmp(engines[i].name, name) == 0)
+      return i;
+  return -1;
+}
+
+const char *checksum_name(int kind)
+{
+  return engines[kind].name;
+}
+
+uint32_t checksum_bytes(int kind, const void *data, size_t len)
+{
+  const struct engine *e = &engines[kind];
+
+  return e->final(e->update(e->init, data, len));
+}
+
+int ComputeChecksum(const struct sim *s, const struct pkt *packet)
+{
+  const struct engine *e = &engines[s->cfg.checksum];
+  uint32_t state;
+
+  if (s->cfg.checksum == CHECKSUM_LEGACY)
+    return (int)legacy_update(packet->seqnum + packet->acknum + packet->length,
+                              (const unsigned char *)packet->payload, packet->length);
+
+  state = e->update(e->init, (const unsigned char *)&packet->seqnum, sizeof(packet->seqnum));
+  state = e->update(state, (const unsigned char *)&packet->acknum, sizeof(packet->acknum));
+  state = e->update(state, (const unsigned char *)&packet->length, sizeof(packet->length));
+  state = e->update(state, (const unsigned char *)packet->payload, packet->length);
+  return (int)e->final(state);
+}
+
+bool IsCorrupted(const struct sim *s, const struct pkt *packet)
+{
+  /* a length the sender could not have used is never summed */
+  if (packet->length < 0 || packet->length > s->cfg.mtu)
+    return (true);
+  if (packet->checksum == ComputeChecksum(s, packet))
+    return (false);
+  else
+    return (true);
+}
@@ -0,0 +1,49 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "emulator.h"
+
+/* ******************************************************************
+   Packet checksums.
+
+   The engine is chosen per run with --checksum:
+   - legacy: the practical's checksum, the sum of seqnum, acknum and
+   the payload bytes, extended to packets with a length: it sums the
+   first length payload bytes rather than always 20 and adds length
+   itself, so its values differ from the original's.  It cannot see
+   reordered bytes or corruptions that cancel out.
+   - internet: the 16 bit ones' complement sum of RFC 1071.
+   - fletcher32: Fletcher's checksum over 16 bit little endian words.
+   - crc32c: CRC-32C (Castagnoli), with the SSE4.2 crc32 instruction
+   when the processor has it and a table otherwise; from 768 bytes on,
+   in three lanes combined with carry-less multiplies (PCLMUL).
+   All but legacy cover seqnum, acknum and length as 4 byte host order
+   integers followed by the first length bytes of the payload.
+**********************************************************************/
+
+#define CHECKSUM_LEGACY     0
+#define CHECKSUM_INTERNET   1
+#define CHECKSUM_FLETCHER32 2
+#define CHECKSUM_CRC32C     3
+#define CHECKSUM_ENGINES    4
+
+/* parse an engine name, -1 if unknown */
+extern int checksum_kind(const char *name);
+extern const char *checksum_name(int kind);
+
+/* checksum of a buffer with one of the engines */
+extern uint32_t checksum_bytes(int kind, const void *data, size_t len);
+
+/* generic procedure to compute the checksum of a packet.  Used by both sender and receiver  
+   the simulator will overwrite part of your packet with 'z's.  It will not overwrite your 
+   original checksum.  This procedure must generate a different checksum to the original if
+   the packet is corrupted.
+*/
+extern int ComputeChecksum(const struct sim *, const struct pkt *packet);
+
+extern bool IsCorrupted(const struct sim *, const struct pkt *packet);
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef COMPARE_H
+#define COMPARE_H
+
+#include "config.h"
+
+/* run cfg->protocol and cfg->compare on cfg->replications paired runs
+   with common random numbers and print the differences of every counter
+   with confidence intervals (also to cfg->report if set); returns 0 on
+   success */
+extern int compare_run(const struct simconfig *cfg);
+
+#endif
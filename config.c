@@ -0,0 +1,521 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "config.h"
+#include "scheduler.h"
+#include "rng.h"
+#include "protocol.h"
+#include "checksum.h"
+#include "cc.h"
+#include "link.h"
+
+/* ******************************************************************
+   Command line, config file and interactive parameter input.
+**********************************************************************/
+
+static const char *linkpolicies[] = { "droptail", "red", "codel" };
+
+static void usage(const char *prog)
+{
+  printf("usage: %s [options]\n", prog);
+  printf("  --messages N        number of messages to simulate\n");
+  printf("  --loss P            packet loss probability\n");
+  printf("  --corrupt P         packet corruption probability\n");
+  printf("  --direction D       loss/corruption direction: 0 A->B, 1 A<-B, 2 both\n");
+  printf("  --lambda T          average time between messages from layer 5\n");
+  printf("  --protocol NAME     transport protocol: gbn or sr\n");
+  printf("  --window N          protocol window size\n");
+  printf("  --seqspace N        size of the sequence number space\n");
+  printf("  --rtt T             retransmission timeout\n");
+  printf("  --rto NAME          fixed timeout of rtt, or adaptive (Jacobson/Karels\n");
+  printf("                      starting from rtt)\n");
+  printf("  --timers NAME       single retransmission timer, or packet for one\n");
+  printf("                      deadline per outstanding packet (sr only)\n");
+  printf("  --sack              SR ACKs carry the cumulative ACK and a bitmap of the\n");
+  printf("                      packets received beyond it (sr only)\n");
+  printf("  --bidirectional     messages arrive at both entities; data packets carry\n");
+  printf("                      the ACKs for the other direction, which are held\n");
+  printf("                      for --delack-time (sr needs --sack)\n");
+  printf("  --dupacks N         gbn goes back at once after N duplicate ACKs\n");
+  printf("                      (fast retransmit, default 0 for never)\n");
+  printf("  --delack K          B acknowledges every K-th in-order packet, or after\n");
+  printf("  --delack-time T     T time units (default rtt / 4); gaps and duplicates\n");
+  printf("                      are acknowledged at once (sr needs --sack)\n");
+  printf("  --cc NAME           congestion window: none, reno (slow start and AIMD)\n");
+  printf("                      or cubic\n");
+  printf("  --cwnd-log FILE     write the congestion window over time as CSV\n");
+  printf("  --sendq N           A queues up to N messages while its window is full\n");
+  printf("                      (default 0: they are dropped)\n");
+  printf("  --sendq-policy NAME drop new messages when the queue is full, or\n");
+  printf("                      backpressure: queue and count them\n");
+  printf("  --bandwidth R       link bytes per time unit, each packet with %d bytes\n", LINK_HEADER);
+  printf("                      of header (default 0: no link, packets only queue\n");
+  printf("                      behind each other's delay)\n");
+  printf("  --delay T           propagation delay (default 1)\n");
+  printf("  --jitter T          random extra delay (default 9)\n");
+  printf("  --jitter-dist NAME  uniform on [0, jitter], or exponential with the\n");
+  printf("                      same mean\n");
+  printf("  --link-queue N      packets the link queues (default 0: no limit)\n");
+  printf("  --link-policy NAME  droptail, red or codel, see link.h\n");
+  printf("  --checksum NAME     legacy, internet, fletcher32 or crc32c\n");
+  printf("  --msgsize N         bytes in each message from layer 5 (default 20); from\n");
+  printf("                      the 27th message on, the last bytes carry its number\n");
+  printf("  --mtu N             largest packet payload (default: the message size)\n");
+  printf("  --trace N           trace level, up to TRACE_BUILD of the build (trace.h)\n");
+  printf("  --trace-file FILE   write the trace as binary records, see tracedump.c\n");
+  printf("  --seed N            random number generator seed (default 9999)\n");
+  printf("  --rng NAME          xoshiro, or compat for the sequence of srand()/rand()\n");
+  printf("  --replication N     independent random streams for the same seed\n");
+  printf("  --crn               common random numbers: the n-th packet of each entity\n");
+  printf("                      is lost, corrupted and delayed alike whatever the protocol\n");
+  printf("  --scheduler NAME    event scheduler: list, heap, heap4, calendar\n");
+  printf("  --pool-debug        poison freed events and packets\n");
+  printf("  --report FILE       write a machine readable summary (\"-\" for stdout)\n");
+  printf("  --format F          summary format: json or csv\n");
+  printf("  --config FILE       read \"key = value\" parameters from FILE\n");
+  printf("  --sweep FILE        run the parameter grid in FILE, see sweep.c\n");
+  printf("  --threads N         worker threads for --sweep (default: all cores)\n");
+  printf("  --compare NAME      run --protocol and NAME on common random numbers and\n");
+  printf("                      report the paired differences, see compare.c\n");
+  printf("  --replications N    runs per sweep point or comparison (default 1)\n");
+  printf("Parameters that are not given are asked for interactively.\n");
+}
+
+static char *copystring(const char *s)
+{
+  char *copy = malloc(strlen(s) + 1);
+  if (copy == NULL) {
+    printf("memory allocation for config failed.");
+    exit(EXIT_FAILURE);
+  }
+  strcpy(copy, s);
+  return copy;
+}
+
+static int parseint(const char *value, int *out)
+{
+  char *end;
+  long v = strtol(value, &end, 10);
+  if (*value == '\0' || *end != '\0')
+    return -1;
+  *out = (int)v;
+  return 0;
+}
+
+static int parsefloat(const char *value, float *out)
+{
+  char *end;
+  double v = strtod(value, &end);
+  if (*value == '\0' || *end != '\0')
+    return -1;
+  *out = (float)v;
+  return 0;
+}
+
+static int parseprob(const char *value, float *out)
+{
+  if (parsefloat(value, out) != 0 || *out < 0.0 || *out > 1.0)
+    return -1;
+  return 0;
+}
+
+int config_set(struct simconfig *cfg, const char *key, const char *value)
+{
+  int v;
+
+  if (strcmp(key, "messages") == 0) {
+    if (parseint(value, &cfg->nsimmax) != 0 || cfg->nsimmax < 0)
+      return -1;
+    cfg->given |= CFG_MESSAGES;
+  }
+  else if (strcmp(key, "loss") == 0) {
+    if (parseprob(value, &cfg->lossprob) != 0)
+      return -1;
+    cfg->given |= CFG_LOSS;
+  }
+  else if (strcmp(key, "corrupt") == 0) {
+    if (parseprob(value, &cfg->corruptprob) != 0)
+      return -1;
+    cfg->given |= CFG_CORRUPT;
+  }
+  else if (strcmp(key, "direction") == 0) {
+    if (parseint(value, &cfg->corruptdirection) != 0 ||
+        cfg->corruptdirection < 0 || cfg->corruptdirection > 2)
+      return -1;
+    cfg->given |= CFG_DIRECTION;
+  }
+  else if (strcmp(key, "lambda") == 0) {
+    if (parsefloat(value, &cfg->lambda) != 0 || cfg->lambda <= 0.0)
+      return -1;
+    cfg->given |= CFG_LAMBDA;
+  }
+  else if (strcmp(key, "protocol") == 0) {
+    if ((cfg->protocol = protocol_find(value)) == NULL)
+      return -1;
+  }
+  else if (strcmp(key, "window") == 0) {
+    if (parseint(value, &cfg->windowsize) != 0 || cfg->windowsize < 1)
+      return -1;
+  }
+  else if (strcmp(key, "seqspace") == 0) {
+    if (parseint(value, &cfg->seqspace) != 0 || cfg->seqspace < 2)
+      return -1;
+  }
+  else if (strcmp(key, "rtt") == 0) {
+    if (parsefloat(value, &cfg->rtt) != 0 || cfg->rtt <= 0.0)
+      return -1;
+  }
+  else if (strcmp(key, "rto") == 0) {
+    if (strcmp(value, "fixed") == 0)
+      cfg->rto = RTO_FIXED;
+    else if (strcmp(value, "adaptive") == 0)
+      cfg->rto = RTO_ADAPTIVE;
+    else
+      return -1;
+  }
+  else if (strcmp(key, "timers") == 0) {
+    if (strcmp(value, "single") == 0)
+      cfg->timers = TIMERS_SINGLE;
+    else if (strcmp(value, "packet") == 0)
+      cfg->timers = TIMERS_PACKET;
+    else
+      return -1;
+  }
+  else if (strcmp(key, "sack") == 0) {
+    if (parseint(value, &cfg->sack) != 0)
+      return -1;
+  }
+  else if (strcmp(key, "bidirectional") == 0) {
+    if (parseint(value, &cfg->bidirectional) != 0)
+      return -1;
+  }
+  else if (strcmp(key, "dupacks") == 0) {
+    if (parseint(value, &cfg->dupacks) != 0 || cfg->dupacks < 0)
+      return -1;
+  }
+  else if (strcmp(key, "delack") == 0) {
+    if (parseint(value, &cfg->delack) != 0 || cfg->delack < 0)
+      return -1;
+  }
+  else if (strcmp(key, "delack-time") == 0) {
+    if (parsefloat(value, &cfg->delacktime) != 0 || cfg->delacktime <= 0.0)
+      return -1;
+  }
+  else if (strcmp(key, "cc") == 0) {
+    if ((cfg->cc = cc_kind(value)) < 0)
+      return -1;
+  }
+  else if (strcmp(key, "cwnd-log") == 0)
+    cfg->cwndlog = copystring(value);
+  else if (strcmp(key, "sendq") == 0) {
+    if (parseint(value, &cfg->sendq) != 0 || cfg->sendq < 0)
+      return -1;
+  }
+  else if (strcmp(key, "sendq-policy") == 0) {
+    if (strcmp(value, "drop") == 0)
+      cfg->sendqpolicy = SENDQ_DROPTAIL;
+    else if (strcmp(value, "backpressure") == 0)
+      cfg->sendqpolicy = SENDQ_BACKPRESSURE;
+    else
+      return -1;
+  }
+  else if (strcmp(key, "bandwidth") == 0) {
+    if (parsefloat(value, &cfg->bandwidth) != 0 || cfg->bandwidth < 0.0)
+      return -1;
+  }
+  else if (strcmp(key, "delay") == 0) {
+    if (parsefloat(value, &cfg->delay) != 0 || cfg->delay < 0.0)
+      return -1;
+  }
+  else if (strcmp(key, "jitter") == 0) {
+    if (parsefloat(value, &cfg->jitter) != 0 || cfg->jitter < 0.0)
+      return -1;
+  }
+  else if (strcmp(key, "jitter-dist") == 0) {
+    if (strcmp(value, "uniform") == 0)
+      cfg->jitterdist = JITTER_UNIFORM;
+    else if (strcmp(value, "exponential") == 0)
+      cfg->jitterdist = JITTER_EXPONENTIAL;
+    else
+      return -1;
+  }
+  else if (strcmp(key, "link-queue") == 0) {
+    if (parseint(value, &cfg->linkqueue) != 0 || cfg->linkqueue < 0)
+      return -1;
+  }
+  else if (strcmp(key, "link-policy") == 0) {
+    if (strcmp(value, "droptail") == 0)
+      cfg->linkpolicy = LINK_DROPTAIL;
+    else if (strcmp(value, "red") == 0)
+      cfg->linkpolicy = LINK_RED;
+    else if (strcmp(value, "codel") == 0)
+      cfg->linkpolicy = LINK_CODEL;
+    else
+      return -1;
+  }
+  else if (strcmp(key, "checksum") == 0) {
+    if ((cfg->checksum = checksum_kind(value)) < 0)
+      return -1;
+  }
+  else if (strcmp(key, "msgsize") == 0) {
+    if (parseint(value, &cfg->msgsize) != 0 || cfg->msgsize < 1 || cfg->msgsize > MAXPAYLOAD)
+      return -1;
+  }
+  else if (strcmp(key, "mtu") == 0) {
+    if (parseint(value, &cfg->mtu) != 0 || cfg->mtu < 1 || cfg->mtu > MAXPAYLOAD)
+      return -1;
+  }
+  else if (strcmp(key, "trace") == 0) {
+    if (parseint(value, &cfg->trace) != 0)
+      return -1;
+    cfg->given |= CFG_TRACE;
+  }
+  else if (strcmp(key, "trace-file") == 0)
+    cfg->tracefile = copystring(value);
+  else if (strcmp(key, "seed") == 0) {
+    if (parseint(value, &v) != 0)
+      return -1;
+    cfg->seed = (unsigned int)v;
+  }
+  else if (strcmp(key, "rng") == 0) {
+    if ((cfg->rng = rng_kind(value)) < 0)
+      return -1;
+  }
+  else if (strcmp(key, "replication") == 0) {
+    if (parseint(value, &v) != 0 || v < 0)
+      return -1;
+    cfg->replication = (unsigned long)v;
+  }
+  else if (strcmp(key, "crn") == 0) {
+    if (parseint(value, &cfg->crn) != 0)
+      return -1;
+  }
+  else if (strcmp(key, "compare") == 0) {
+    if ((cfg->compare = protocol_find(value)) == NULL)
+      return -1;
+  }
+  else if (strcmp(key, "replications") == 0) {
+    if (parseint(value, &cfg->replications) != 0 || cfg->replications < 1)
+      return -1;
+  }
+  else if (strcmp(key, "scheduler") == 0) {
+    if ((cfg->scheduler = sched_kind(value)) < 0)
+      return -1;
+  }
+  else if (strcmp(key, "pool-debug") == 0) {
+    if (parseint(value, &cfg->pooldebug) != 0)
+      return -1;
+  }
+  else if (strcmp(key, "report") == 0)
+    cfg->report = copystring(value);
+  else if (strcmp(key, "sweep") == 0)
+    cfg->sweep = copystring(value);
+  else if (strcmp(key, "threads") == 0) {
+    if (parseint(value, &cfg->threads) != 0 || cfg->threads < 0)
+      return -1;
+  }
+  else if (strcmp(key, "format") == 0) {
+    if (strcmp(value, "json") == 0)
+      cfg->reportformat = REPORT_JSON;
+    else if (strcmp(value, "csv") == 0)
+      cfg->reportformat = REPORT_CSV;
+    else
+      return -1;
+  }
+  else
+    return -1;
+  return 0;
+}
+
+/* strip leading and trailing white space in place */
+static char *trim(char *s)
+{
+  char *end;
+
+  while (isspace((unsigned char)*s))
+    s++;
+  end = s + strlen(s);
+  while (end > s && isspace((unsigned char)end[-1]))
+    *--end = '\0';
+  return s;
+}
+
+int config_read(const char *path, int (*set)(void *, const char *, const char *), void *arg)
+{
+  FILE *f;
+  char line[512], *key, *value, *p;
+  int lineno = 0;
+
+  if ((f = fopen(path, "r")) == NULL) {
+    printf("cannot open config file %s\n", path);
+    return -1;
+  }
+  while (fgets(line, sizeof(line), f) != NULL) {
+    lineno++;
+    if ((p = strchr(line, '#')) != NULL)
+      *p = '\0';
+    key = trim(line);
+    if (*key == '\0')
+      continue;
+    if ((p = strchr(key, '=')) == NULL) {
+      printf("%s:%d: expected key = value\n", path, lineno);
+      fclose(f);
+      return -1;
+    }
+    *p = '\0';
+    key = trim(key);
+    value = trim(p + 1);
+    if (set(arg, key, value) != 0) {
+      printf("%s:%d: invalid parameter %s = %s\n", path, lineno, key, value);
+      fclose(f);
+      return -1;
+    }
+  }
+  fclose(f);
+  return 0;
+}
+
+static int setconfig(void *cfg, const char *key, const char *value)
+{
+  return config_set(cfg, key, value);
+}
+
+int config_load(struct simconfig *cfg, const char *path)
+{
+  return config_read(path, setconfig, cfg);
+}
+
+void config_report(const struct simconfig *cfg, struct report *r)
+{
+  report_string(r, "protocol", cfg->protocol->name);
+  report_int(r, "messages", cfg->nsimmax);
+  report_real(r, "loss", cfg->lossprob);
+  report_real(r, "corrupt", cfg->corruptprob);
+  report_int(r, "direction", cfg->corruptdirection);
+  report_real(r, "lambda", cfg->lambda);
+  report_int(r, "window", cfg->windowsize);
+  report_int(r, "seqspace", cfg->seqspace);
+  report_real(r, "rtt", cfg->rtt);
+  report_string(r, "rto", cfg->rto == RTO_ADAPTIVE ? "adaptive" : "fixed");
+  report_int(r, "sack", cfg->sack);
+  report_int(r, "bidirectional", cfg->bidirectional);
+  report_int(r, "dupacks", cfg->dupacks);
+  report_int(r, "delack", cfg->delack);
+  report_real(r, "delack_time", cfg->delacktime);
+  report_string(r, "timers", cfg->timers == TIMERS_PACKET ? "packet" : "single");
+  report_string(r, "cc", cc_name(cfg->cc));
+  report_int(r, "sendq", cfg->sendq);
+  report_string(r, "sendq_policy", cfg->sendqpolicy == SENDQ_BACKPRESSURE ? "backpressure" : "drop");
+  report_real(r, "bandwidth", cfg->bandwidth);
+  report_real(r, "delay", cfg->delay);
+  report_real(r, "jitter", cfg->jitter);
+  report_string(r, "jitter_dist", cfg->jitterdist == JITTER_EXPONENTIAL ? "exponential" : "uniform");
+  report_int(r, "link_queue", cfg->linkqueue);
+  report_string(r, "link_policy", linkpolicies[cfg->linkpolicy]);
+  report_string(r, "checksum", checksum_name(cfg->checksum));
+  report_int(r, "msgsize", cfg->msgsize);
+  report_int(r, "mtu", cfg->mtu);
+  report_int(r, "seed", cfg->seed);
+  report_string(r, "rng", rng_name(cfg->rng));
+  report_int(r, "replication", (long)cfg->replication);
+  report_int(r, "crn", cfg->crn);
+}
+
+void config_parse(struct simconfig *cfg, int argc, char **argv)
+{
+  const char *name, *value;
+  char key[64];
+  int i;
+
+  memset(cfg, 0, sizeof(*cfg));
+  cfg->seed = 9999;
+  cfg->rng = RNG_XOSHIRO;
+  cfg->protocol = protocol_default();
+  cfg->replications = 1;
+  cfg->msgsize = 20;
+  cfg->delay = 1.0;
+  cfg->jitter = 9.0;
+  cfg->scheduler = SCHED_HEAP4;
+  cfg->reportformat = REPORT_JSON;
+
+  /* the environment gives defaults for the debugging knobs */
+  if ((name = getenv("EMULATOR_SCHEDULER")) != NULL &&
+      (cfg->scheduler = sched_kind(name)) < 0) {
+    printf("Unknown EMULATOR_SCHEDULER \"%s\" (use list, heap, heap4 or calendar)\n", name);
+    exit(EXIT_FAILURE);
+  }
+  if ((name = getenv("EMULATOR_POOL_DEBUG")) != NULL)
+    cfg->pooldebug = atoi(name);
+
+  for (i = 1; i < argc; i++) {
+    name = argv[i];
+    if (strcmp(name, "--help") == 0 || strcmp(name, "-h") == 0) {
+      usage(argv[0]);
+      exit(EXIT_SUCCESS);
+    }
+    if (strncmp(name, "--", 2) != 0) {
+      printf("unexpected argument %s\n", name);
+      usage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+    name += 2;
+
+    /* --key=value or --key value; --pool-debug, --crn and --sack take no value */
+    if ((value = strchr(name, '=')) != NULL) {
+      snprintf(key, sizeof(key), "%.*s", (int)(value - name), name);
+      value++;
+    }
+    else {
+      snprintf(key, sizeof(key), "%s", name);
+      if (strcmp(key, "pool-debug") == 0 || strcmp(key, "crn") == 0 || strcmp(key, "sack") == 0 ||
+          strcmp(key, "bidirectional") == 0)
+        value = "1";
+      else if (i + 1 < argc)
+        value = argv[++i];
+      else {
+        printf("missing value for --%s\n", key);
+        exit(EXIT_FAILURE);
+      }
+    }
+
+    if (strcmp(key, "config") == 0) {
+      if (config_load(cfg, value) != 0)
+        exit(EXIT_FAILURE);
+    }
+    else if (config_set(cfg, key, value) != 0) {
+      printf("invalid option --%s %s\n", key, value);
+      usage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+void config_prompt(struct simconfig *cfg)
+{
+  if (!(cfg->given & CFG_MESSAGES)) {
+    printf("Enter the number of messages to simulate: ");
+    scanf("%d",&cfg->nsimmax);
+  }
+  if (!(cfg->given & CFG_LOSS)) {
+    printf("Enter  packet loss probability [enter 0.0 for no loss]:");
+    scanf("%f",&cfg->lossprob);
+  }
+  if (!(cfg->given & CFG_CORRUPT)) {
+    printf("Enter packet corruption probability [0.0 for no corruption]:");
+    scanf("%f",&cfg->corruptprob);
+  }
+  if (!(cfg->given & CFG_DIRECTION) && (cfg->lossprob != 0.0 || cfg->corruptprob != 0.0)) {
+    printf("If you want loss or corruption to only occur in one direction, choose the direction: 0 A->B, 1 A<-B, 2 A<->B (both directions) :");
+    scanf("%d",&cfg->corruptdirection);
+  }
+  if (!(cfg->given & CFG_LAMBDA)) {
+    printf("Enter average time between messages from sender's layer5 [ > 0.0]:");
+    scanf("%f",&cfg->lambda);
+  }
+  if (!(cfg->given & CFG_TRACE)) {
+    printf("Enter TRACE:");
+    scanf("%d",&cfg->trace);
+  }
+  cfg->given |= CFG_MESSAGES | CFG_LOSS | CFG_CORRUPT | CFG_DIRECTION | CFG_LAMBDA | CFG_TRACE;
+}
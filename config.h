@@ -0,0 +1,117 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "report.h"
+
+/* ******************************************************************
+   Run parameters of the emulator.
+
+   Parameters can be given on the command line (--messages 1000), in a
+   config file (messages = 1000, one per line, '#' starts a comment) or
+   interactively: anything not given on the command line or in a config
+   file is asked for with the original prompts.
+**********************************************************************/
+
+struct protocol;
+
+/* bits of simconfig.given */
+#define CFG_MESSAGES   0x01
+#define CFG_LOSS       0x02
+#define CFG_CORRUPT    0x04
+#define CFG_DIRECTION  0x08
+#define CFG_LAMBDA     0x10
+#define CFG_TRACE      0x20
+
+/* simconfig.timers */
+#define TIMERS_SINGLE  0   /* one retransmission timer for the window */
+#define TIMERS_PACKET  1   /* a deadline per outstanding packet */
+
+/* simconfig.rto */
+#define RTO_FIXED      0   /* the timeout is always rtt */
+#define RTO_ADAPTIVE   1   /* estimated from round trips, see rto.h */
+
+/* simconfig.sendqpolicy, see sendq.h */
+#define SENDQ_DROPTAIL     0   /* a full queue refuses new messages */
+#define SENDQ_BACKPRESSURE 1   /* ... or counts them and grows */
+
+/* simconfig.jitterdist */
+#define JITTER_UNIFORM     0   /* uniform on [0, jitter] */
+#define JITTER_EXPONENTIAL 1   /* exponential with the same mean, jitter / 2 */
+
+/* simconfig.linkpolicy, see link.h */
+#define LINK_DROPTAIL      0   /* drop packets that find the queue full */
+#define LINK_RED           1   /* ... and early ones at random (RED) */
+#define LINK_CODEL         2   /* ... and those that waited too long (CoDel) */
+
+struct simconfig {
+  int given;               /* CFG_* bits of the parameters already set */
+
+  int nsimmax;             /* number of msgs to generate, then stop */
+  float lossprob;          /* probability that a packet is dropped  */
+  float corruptprob;       /* probability that one bit is packet is flipped */
+  int corruptdirection;    /* A->B A<-B or bidirectional corruption/loss */
+  float lambda;            /* arrival rate of messages from layer 5 */
+  const struct protocol *protocol;   /* see protocol.h */
+  int windowsize;          /* protocol window, 0 for the protocol's default */
+  int seqspace;            /* sequence numbers, 0 for the smallest the window allows */
+  float rtt;               /* retransmission timeout, 0 for the default */
+  int timers;              /* TIMERS_SINGLE or TIMERS_PACKET */
+  int sack;                /* SR: cumulative ACKs with a bitmap of later packets */
+  int bidirectional;       /* full duplex: messages arrive at A and B alike */
+  int dupacks;             /* GBN: duplicate ACKs that trigger a fast retransmit, 0 for none */
+  int delack;              /* B ACKs every delack-th in-order packet, 0 or 1 for every one */
+  float delacktime;        /* ... or this long after the first unacknowledged one */
+  int rto;                 /* RTO_FIXED or RTO_ADAPTIVE */
+  int cc;                  /* CC_* congestion control, see cc.h */
+  const char *cwndlog;     /* CSV file of the congestion window over time */
+  int sendq;               /* messages A queues while the window is full, 0 for none */
+  int sendqpolicy;         /* SENDQ_DROPTAIL or SENDQ_BACKPRESSURE */
+  float bandwidth;         /* link bytes per time unit, 0 for none */
+  float delay;             /* propagation delay of the medium */
+  float jitter;            /* ... plus a random delay of this scale */
+  int jitterdist;          /* JITTER_UNIFORM or JITTER_EXPONENTIAL */
+  int linkqueue;           /* packets a link queues, 0 for no limit */
+  int linkpolicy;          /* LINK_DROPTAIL, LINK_RED or LINK_CODEL */
+  int checksum;            /* CHECKSUM_* engine, see checksum.h */
+  int msgsize;             /* bytes in each message from layer 5 */
+  int mtu;                 /* largest packet payload, 0 for msgsize */
+  int trace;
+  const char *tracefile;   /* binary trace records instead of text, see trace.h */
+  unsigned int seed;       /* random number generator seed */
+  int rng;                 /* RNG_XOSHIRO or RNG_COMPAT, see rng.h */
+  unsigned long replication;   /* selects an independent set of streams */
+  int crn;                 /* common random numbers: packet fates keyed by index */
+
+  int scheduler;           /* SCHED_* event scheduler */
+  int pooldebug;           /* poison freed pool objects */
+
+  const char *report;      /* machine readable summary file, "-" for stdout */
+  int reportformat;        /* REPORT_JSON or REPORT_CSV, see report.h */
+
+  const char *sweep;       /* parameter grid to run instead of one simulation */
+  int threads;             /* worker threads for a sweep, 0 for one per core */
+  int replications;        /* runs per sweep point or comparison */
+  const struct protocol *compare;   /* protocol to compare with, see compare.c */
+};
+
+/* fill in defaults, then apply the command line (and any config files
+   it names); exits with a message on invalid arguments */
+extern void config_parse(struct simconfig *, int argc, char **argv);
+
+/* set one parameter by name, returns 0 on success */
+extern int config_set(struct simconfig *, const char *key, const char *value);
+
+/* read "key = value" lines from a file, returns 0 on success */
+extern int config_load(struct simconfig *, const char *path);
+
+/* call set(arg, key, value) for every "key = value" line of a file,
+   stopping with an error message if set() fails; returns 0 on success */
+extern int config_read(const char *path, int (*set)(void *, const char *, const char *), void *arg);
+
+/* add the simulation parameters to a report */
+extern void config_report(const struct simconfig *, struct report *);
+
+/* ask for every parameter that has not been given yet */
+extern void config_prompt(struct simconfig *);
+
+#endif
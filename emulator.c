@@ -33,22 +33,92 @@
    soon as n packets are sent.
    - fixed C style to adhere to current programming style
 
+   Modifications:
+   - pending events are kept by a pluggable scheduler (scheduler.c):
+   sorted list, binary heap, 4-ary heap or calendar queue, chosen with
+   the EMULATOR_SCHEDULER environment variable (default heap4).  All
+   of them deliver events in the order of the original list.
+   - starttimer()/stoptimer() keep a handle on each entity's timer event
+   instead of searching the event list; a stopped timer is marked as
+   cancelled and dropped when it reaches the head of the queue.
+   - tolayer3() keeps a channel per direction with the arrival time of
+   the last packet in flight and the in-flight count, instead of
+   searching the event list for the latest arrival.
+   - events and packet copies come from slab pools (pool.c); setting
+   EMULATOR_POOL_DEBUG=1 poisons freed objects to catch use-after-free
+   and prints the pools' occupancy counters at the end of the run.
+   - parameters can be given on the command line or in a config file
+   (see config.c, "--help" lists them); anything missing is prompted
+   for as before.  --report writes the final summary as JSON or CSV.
+   - all emulator and protocol state lives in a struct sim passed to
+   every routine, so several simulations can run in one process.
+   - --sweep runs a grid of parameters on a pool of worker threads
+   and streams one aggregated row per grid point (see sweep.c).
+   - random numbers come from a per-simulation xoshiro256** generator
+   (rng.c) with separate streams for arrivals, loss, corruption and
+   delay, split per replication from one seed.  "--rng compat" draws
+   the same sequence as srand()/rand() did instead.
+   - trace messages are trace points (trace.h) that compile away above
+   TRACE_BUILD, which is 0 unless the build sets it; --trace-file
+   writes them as binary records to be printed later with tracedump.
+   - every message accepted from layer 5 is timestamped and matched on
+   delivery; the summary and --report give latency percentiles from
+   an HDR histogram (hdr.c), goodput and the retransmission overhead.
+   To match them, the last bytes of every message from the 27th on
+   carry its number (msg_fill()), so layer 5 no longer sees one letter
+   repeated.  With --msgsize below MSGSTAMP + 1 the numbers wrap
+   around, and sim_warn() says that latencies may then be matched to
+   the wrong message.
+   - the protocols' window size, sequence space and RTT are run time
+   parameters (--window, --seqspace, --rtt), checked by sim_configure().
+   - GBN and SR are linked into one simulator as protocol plugins
+   (protocol.h) and chosen with --protocol; they share checksum.c.
+   - with --crn the loss, corruption and delay of a packet are keyed by
+   its direction and index instead of the order of the draws, and
+   --compare runs two protocols on such common random numbers and
+   reports paired differences (compare.c).
+   - the packet checksum is one of several engines (checksum.c), chosen
+   with --checksum; bench_checksum measures their throughput.
+   - --rto adaptive estimates the retransmission timeout from round
+   trips (rto.c); spurious resends are counted in either mode.
+   - messages carry --msgsize bytes and packets up to --mtu bytes (at
+   most MAXPAYLOAD, a jumbo frame); a packet's length field is covered
+   by its checksum, and packets are passed by pointer and copied only
+   up to their length.
+   - packets are reference counted buffers (pkt_alloc): each message is
+   built in one, and the sender's retransmission buffer, the packets in
+   flight and the receiver share it through tolayer3_shared() instead
+   of copying; corruption copies a shared packet first.
+   - --cc reno or cubic limits the sender to a congestion window
+   (cc.c), which --cwnd-log writes out over time.
+   - --sendq lets the sender queue messages while its window is full
+   (sendq.c) instead of dropping them.
+   - --bidirectional sends messages both ways, with the ACKs riding on
+   the data packets; each entity's two timers share the emulator timer
+   (timer.c).
+   - --bandwidth gives the medium a link with a finite queue, dropping
+   with drop-tail, RED or CoDel (link.c); --delay and --jitter set the
+   propagation delay and its random part, 1 and 9 as before.
+
+   Build with, e.g. (leave out -DTRACE_BUILD=4 for a build without
+   trace messages):
+     gcc -Wall -DTRACE_BUILD=4 emulator.c scheduler.c pool.c config.c report.c rng.c sweep.c trace.c hdr.c \
+         protocol.c checksum.c compare.c rto.c cc.c sendq.c timer.c link.c gbn.c sr.c -lm -pthread -o emulator
+     gcc -Wall tracedump.c trace.c -o tracedump
+     gcc -Wall -O2 bench_checksum.c checksum.c -o bench_checksum
+
    ********************************************************************* */
 #include <stdlib.h>
 #include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
 #include "emulator.h"
-#include "gbn.h"
-
-struct event {
-  float evtime;           /* event time */
-  int evtype;             /* event type code */
-  int eventity;           /* entity where event occurs */
-  struct pkt *pktptr;     /* ptr to packet (if any) assoc w/ this event */
-  struct event *prev;
-  struct event *next;
-};
-
-struct event *evlist = NULL;   /* the event list */
+#include "protocol.h"
+#include "report.h"
+#include "sweep.h"
+#include "compare.h"
+#include "trace.h"
 
 /* possible events: */
 #define  TIMER_INTERRUPT 0  
@@ -58,149 +128,284 @@ struct event *evlist = NULL;   /* the event list */
 #define  OFF             0
 #define  ON              1
 
-int TRACE = 3;
-
-/* statistics updated by GBN */
-int window_full;   /* count of the number of messages dropped due to full window */
-int total_ACKs_received;
-int packets_resent;       /* count of the number of packets resent  */
-int new_ACKs;           /* count of the number of acks correctly received */
-int packets_received;  /* count of the packets received by receiver */
-
-/* statistics updated by emulator */
-static int packets_lost;  
-static int packets_corrupt;
-static int packets_sent;
-static int packets_timeout;
-static int messages_delivered;
-
-static int nsim = 0;              /* number of messages from 5 to 4 so far */ 
-static int nsimmax = 0;           /* number of msgs to generate, then stop */
-static float time = 0.000;
-static float lossprob;            /* probability that a packet is dropped  */
-static float corruptprob;   /* probability that one bit is packet is flipped */
-static int corruptdirection; /* A->B A<-B or bidirectional corruption/loss */
-static float lambda;        /* arrival rate of messages from layer 5 */   
-static int   ntolayer3;           /* number sent into layer 3 */
-static int   nlost;               /* number lost in media */
-static int ncorrupt;              /* number corrupted by media*/
+#define POOL_SLAB 256            /* objects carved from each pool slab */
+
+/* latencies are kept to 3 significant digits from 0.001 to 10^7 time units */
+#define LATENCY_UNIT    0.001
+#define LATENCY_HIGHEST 1e7
+#define LATENCY_DIGITS  3
+
+/* bytes at the end of a message that carry its number */
+#define MSGSTAMP 6
+
+/* a block handed out by simalloc(), the memory follows the header */
+struct allocation {
+  struct allocation *next;
+  double align;
+};
+
+/* a packet from the packet pool with its reference count in front */
+struct pktbuf {
+  int refs;
+  struct pkt pkt;
+};
+
+#define PKTBUF(p) ((struct pktbuf *)((char *)(p) - offsetof(struct pktbuf, pkt)))
 
 /****************************************************************************/
 /* jimsrand(): return a double in range [0,1].  The routine below is used to */
-/* isolate all random number generation in one location.  We assume that the*/
-/* system-supplied rand() function return an int in therange [0,mmm]        */
+/* isolate all random number generation in one location.  Every purpose     */
+/* (RNG_ARRIVAL, RNG_LOSS, ...) draws from its own stream, see rng.h        */
 /****************************************************************************/
-double jimsrand(void) 
+double jimsrand(struct sim *s, int purpose) 
 {
-  double mmm = RAND_MAX;     /* largest int  - MACHINE DEPENDENT!!!!!!!!   */
   double x;                   
-  x = rand()/mmm;            /* x should be uniform in [0,1] */
-  if (TRACE > 3)
-    printf("RANDOM NUMBER GENERAION CALLED: %f\n", x);
+  x = rng_uniform(&s->rng, purpose); /* x should be uniform in [0,1] */
+  TRACE_VALUE(s, 4, TR_RANDOM, A, x);
   return(x);
 }  
 
+/* jimsrand() for the fate of the packet AorB is sending.  With common */
+/* random numbers (--crn) the number depends only on the direction and */
+/* on how many packets AorB has sent, so runs of different protocols   */
+/* lose, corrupt and delay their n-th packet alike.                     */
+double packetrand(struct sim *s, int purpose, int AorB, int draw)
+{
+  double x;
+  if (!s->cfg.crn)
+    return jimsrand(s, purpose);
+  x = rng_keyed(&s->rng, purpose, AorB, s->stats.nsent[AorB], draw);
+  TRACE_VALUE(s, 4, TR_RANDOM, AorB, x);
+  return(x);
+}
+
 /********************* EVENT HANDLINE ROUTINES *******/
 /*  The next set of routines handle the event list   */
 /*****************************************************/
 
-void insertevent(struct event *p)
+void insertevent(struct sim *s, struct event *p)
 {
-  struct event *q,*qold;
-
-  if (TRACE>2) {
-    printf("            INSERTEVENT: time is %f\n",time);
-    printf("            INSERTEVENT: future time will be %f\n",p->evtime); 
-  }
-  q = evlist;     /* q points to front of list in which p struct inserted */
-  if (q==NULL) {   /* list is empty */
-    evlist=p;
-    p->next=NULL;
-    p->prev=NULL;
-  }
-  else {
-    for (qold = q; q !=NULL && p->evtime > q->evtime; q=q->next)
-      qold=q; 
-    if (q==NULL) {   /* end of list */
-      qold->next = p;
-      p->prev = qold;
-      p->next = NULL;
-    }
-    else if (q==evlist) { /* front of list */
-      p->next=evlist;
-      p->prev=NULL;
-      p->next->prev=p;
-      evlist = p;
-    }
-    else {     /* middle of list */
-      p->next=q;
-      p->prev=q->prev;
-      q->prev->next=p;
-      q->prev=p;
-    }
-  }
+  TRACE_VALUE(s, 3, TR_INSERTEVENT, p->eventity, p->evtime);
+  p->cancelled = 0;
+  sched_insert(&s->evlist, p);
 }
 
-void generate_next_arrival(void)
+void generate_next_arrival(struct sim *s)
 {
   double x;
   struct event *evptr;
 
-  if (TRACE>2)
-    printf("          GENERATE NEXT ARRIVAL: creating new arrival\n");
+  TRACE(s, 3, TR_ARRIVAL, A);
  
-  x = lambda*jimsrand()*2;  /* x is uniform on [0,2*lambda] */
+  x = s->cfg.lambda*jimsrand(s, RNG_ARRIVAL)*2;  /* x is uniform on [0,2*lambda] */
   /* having mean of lambda        */
-  evptr = malloc(sizeof(struct event));
-  if (evptr == 0) {
-    printf("memory allocation for event failed.");
-    exit(EXIT_FAILURE);
-  }
-  evptr->evtime =  time + x;
+  evptr = pool_alloc(&s->eventpool);
+  evptr->evtime =  s->time + x;
   evptr->evtype =  FROM_LAYER5;
-  if (BIDIRECTIONAL && (jimsrand()>0.5) )
+  if (s->cfg.bidirectional && (jimsrand(s, RNG_ARRIVAL)>0.5) )
     evptr->eventity = B;
   else
     evptr->eventity = A;
-  insertevent(evptr);
+  insertevent(s, evptr);
 } 
 
-void printevlist(void)
+static void printevent(struct event *q, void *unused)
 {
-  struct event *q;
-  printf("--------------\nEvent List Follows:\n");
-  for(q = evlist; q!=NULL; q=q->next) {
+  (void)unused;
+  if (!q->cancelled)
     printf("Event time: %f, type: %d entity: %d\n",q->evtime,q->evtype,q->eventity);
-  }
+}
+
+void printevlist(struct sim *s)
+{
+  printf("--------------\nEvent List Follows:\n");
+  sched_foreach(&s->evlist, printevent, NULL);
   printf("--------------\n");
 }
 
-void init(void)                         /* initialize the simulator */
+/********************** MESSAGE LATENCY ***********************/
+
+/* the n-th message is a string of the n-th letter, as it always was,
+   except that its last bytes carry n / 26 in base 26, each digit as
+   the letter that many after its own; the first 26 messages are
+   unchanged.  Deliveries are matched to messages by this number. */
+static int stampbytes(int length)
 {
-  float sum, avg;
+  return length - 1 < MSGSTAMP ? length - 1 : MSGSTAMP;
+}
+
+static void msg_fill(char *payload, int length, int n)
+{
+  int letter = n % 26, q = n / 26, i;
+
+  memset(payload, 'a' + letter, length);
+  for (i = 1; i <= stampbytes(length); i++, q /= 26)
+    payload[length - i] = 'a' + (letter + q % 26) % 26;
+}
+
+/* the number of a message, modulo msg_range() */
+static long msg_number(const char *data, int length)
+{
+  int letter = (data[0] - 'a' + 26) % 26, i;
+  long q = 0;
+
+  for (i = stampbytes(length); i >= 1; i--)
+    q = q * 26 + (data[length - i] - 'a' - letter + 52) % 26;
+  return q * 26 + letter;
+}
+
+static long msg_range(int length)
+{
+  long range = 26;
   int i;
 
-  printf("-----  Stop and Wait Network Simulator Version 1.1 -------- \n\n");
-  printf("Enter the number of messages to simulate: ");
-  scanf("%d",&nsimmax);
-  printf("Enter  packet loss probability [enter 0.0 for no loss]:");
-  scanf("%f",&lossprob);
-  printf("Enter packet corruption probability [0.0 for no corruption]:");
-  scanf("%f",&corruptprob);
-  if (lossprob != 0.0 || corruptprob != 0.0) {
-    printf("If you want loss or corruption to only occur in one direction, choose the direction: 0 A->B, 1 A<-B, 2 A<->B (both directions) :");
-    scanf("%d",&corruptdirection);
+  for (i = 0; i < stampbytes(length); i++)
+    range *= 26;
+  return range;
+}
+
+/* entity AorB accepted message s->nsim - 1 from layer 5 at the current time */
+static void message_sent(struct sim *s, int AorB)
+{
+  struct msgqueue *q = &s->pending[AorB];
+  struct sentmsg *msgs;
+  int i;
+
+  if (q->count == q->size) {
+    msgs = malloc((q->size > 0 ? 2 * q->size : 16) * sizeof(struct sentmsg));
+    if (msgs == NULL) {
+      printf("memory allocation for message times failed.");
+      exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < q->count; i++)
+      msgs[i] = q->msgs[(q->first + i) % q->size];
+    free(q->msgs);
+    q->msgs = msgs;
+    q->first = 0;
+    q->size = q->size > 0 ? 2 * q->size : 16;
   }
-  printf("Enter average time between messages from sender's layer5 [ > 0.0]:");
-  scanf("%f",&lambda);
-  printf("Enter TRACE:");
-  scanf("%d",&TRACE);
+  msgs = &q->msgs[(q->first + q->count++) % q->size];
+  msgs->time = s->time;
+  msgs->number = s->nsim - 1;
+  msgs->delivered = 0;
+}
 
+/* a message from AorB reached the other side's layer 5.  It is the
+   pending message with the number the data carries; a protocol that
+   delivers in order always finds it at the front.  Data that matches
+   nothing pending is a duplicate of a message delivered before. */
+static void message_delivered(struct sim *s, int AorB, const char *data, int length)
+{
+  struct msgqueue *q = &s->pending[AorB];
+  struct sentmsg *m = NULL;
+  long number = msg_number(data, length), range = msg_range(length);
+  int i;
 
-  srand(9999);              /* init random number generator */
+  for (i = 0; i < q->count; i++) {
+    m = &q->msgs[(q->first + i) % q->size];
+    if (!m->delivered && m->number % range == number)
+      break;
+  }
+  if (i == q->count)
+    return;
+  hdr_record(&s->latency, s->time - m->time);
+  m->delivered = 1;
+  while (q->count > 0 && q->msgs[q->first].delivered) {
+    q->first = (q->first + 1) % q->size;
+    q->count--;
+  }
+}
+
+/********************** SIMULATION LIFECYCLE ***********************/
+
+void *simalloc(struct sim *s, size_t size)
+{
+  struct allocation *a;
+
+  a = calloc(1, sizeof(struct allocation) + size);
+  if (a == NULL) {
+    printf("memory allocation for protocol state failed.");
+    exit(EXIT_FAILURE);
+  }
+  a->next = s->allocations;
+  s->allocations = a;
+  return a + 1;
+}
+
+void simfree(struct sim *s, void *p)
+{
+  struct allocation **a;
+
+  for (a = &s->allocations; *a != NULL; a = &(*a)->next)
+    if (*a + 1 == p) {
+      p = *a;
+      *a = (*a)->next;
+      free(p);
+      return;
+    }
+}
+
+int sim_configure(struct simconfig *cfg)
+{
+  if (cfg->mtu == 0)
+    cfg->mtu = cfg->msgsize;
+  if (cfg->msgsize < 1 || cfg->msgsize > cfg->mtu || cfg->mtu > MAXPAYLOAD) {
+    printf("the message size (%d) must be between 1 and the MTU (%d), at most %d\n",
+           cfg->msgsize, cfg->mtu, MAXPAYLOAD);
+    return -1;
+  }
+  if (cfg->protocol->configure(cfg) != 0)
+    return -1;
+  if (cfg->bandwidth > 0.0 && cfg->linkpolicy == LINK_RED && cfg->linkqueue == 0) {
+    printf("RED drops relative to the size of the link queue, it needs --link-queue\n");
+    return -1;
+  }
+  if ((cfg->delack > 1 || cfg->bidirectional) && cfg->delacktime == 0.0)
+    cfg->delacktime = cfg->rtt / 4;
+  return 0;
+}
+
+void sim_warn(const struct simconfig *cfg)
+{
+  if (cfg->trace > TRACE_BUILD)
+    printf("this emulator was built with TRACE_BUILD %d, trace levels above it print nothing\n",
+           TRACE_BUILD);
+  if (cfg->msgsize <= MSGSTAMP && cfg->nsimmax > msg_range(cfg->msgsize))
+    printf("with --msgsize %d only %ld messages have distinct numbers, latencies may be matched to the wrong message\n",
+           cfg->msgsize, msg_range(cfg->msgsize));
+}
+
+struct sim *sim_create(const struct simconfig *cfg)  /* initialize the simulator */
+{
+  struct sim *s;
+  float sum, avg;
+  int i;
+
+  s = calloc(1, sizeof(struct sim));
+  if (s == NULL) {
+    printf("memory allocation for simulation failed.");
+    exit(EXIT_FAILURE);
+  }
+  s->cfg = *cfg;
+  if (sim_configure(&s->cfg) != 0)
+    exit(EXIT_FAILURE);
+  s->proto = cfg->protocol;
+  s->trace = cfg->trace;
+  if (cfg->tracefile != NULL && trace_open(s, cfg->tracefile) != 0)
+    exit(EXIT_FAILURE);
+  if (cfg->cwndlog != NULL) {
+    if ((s->cwndlog = fopen(cfg->cwndlog, "w")) == NULL) {
+      printf("cannot open congestion window log %s\n", cfg->cwndlog);
+      exit(EXIT_FAILURE);
+    }
+    fprintf(s->cwndlog, "time,cwnd,ssthresh\n");
+  }
+
+  /* init random number generator */
+  rng_seed(&s->rng, cfg->rng, cfg->seed, cfg->replication);
   sum = 0.0;                /* test random number generator for students */
   for (i=0; i<1000; i++)
-    sum+=jimsrand();    /* jimsrand() should be uniform in [0,1] */
+    sum+=jimsrand(s, RNG_ARRIVAL);    /* jimsrand() should be uniform in [0,1] */
   avg = sum/1000.0;
   if (avg < 0.25 || avg > 0.75) {
     printf("It is likely that random number generation on your machine\n" ); 
@@ -209,270 +414,542 @@ void init(void)                         /* initialize the simulator */
     exit(EXIT_FAILURE);
   }
 
-  /* initialise statistics */
-  window_full = 0;
-  total_ACKs_received = 0;
-  packets_resent = 0;
-  new_ACKs = 0;
-  packets_received = 0;
-  packets_lost = 0;  
-  packets_corrupt = 0;
-  packets_sent = 0;
-  packets_timeout = 0;
-  messages_delivered = 0;
+  /* all schedulers give identical results */
+  sched_init(&s->evlist, cfg->scheduler);
+
+  /* pool debugging catches protocol code touching freed packets */
+  pool_init(&s->eventpool, sizeof(struct event), POOL_SLAB, cfg->pooldebug);
+  /* packet copies only need room for the MTU */
+  pool_init(&s->pktpool, offsetof(struct pktbuf, pkt.payload) + s->cfg.mtu, POOL_SLAB, cfg->pooldebug);
+  hdr_init(&s->latency, LATENCY_UNIT, LATENCY_HIGHEST, LATENCY_DIGITS);
+  hdr_init(&s->queuedelay, LATENCY_UNIT, LATENCY_HIGHEST, LATENCY_DIGITS);
+  link_init(s, &s->channels[A].link);
+  link_init(s, &s->channels[B].link);
+
+  s->time=0.0;                 /* initialize time to 0.0 */
+  generate_next_arrival(s);    /* initialize event list */
+  s->proto->A_init(s);
+  s->proto->B_init(s);
+  return s;
+}
 
-  ntolayer3 = 0;
-  nlost = 0;
-  ncorrupt = 0;
+void sim_destroy(struct sim *s)
+{
+  struct allocation *a, *next;
 
-  time=0.0;                    /* initialize time to 0.0 */
-  generate_next_arrival();     /* initialize event list */
+  for (a = s->allocations; a != NULL; a = next) {
+    next = a->next;
+    free(a);
+  }
+  sched_free(&s->evlist);
+  pool_destroy(&s->eventpool);
+  pool_destroy(&s->pktpool);
+  hdr_free(&s->latency);
+  hdr_free(&s->queuedelay);
+  free(s->pending[A].msgs);
+  free(s->pending[B].msgs);
+  trace_close(s);
+  if (s->cwndlog != NULL)
+    fclose(s->cwndlog);
+  free(s);
 }
 
 /********************** Student-callable ROUTINES ***********************/
 
 /* called by students routine to cancel a previously-started timer */
-void stoptimer(int AorB)
+void stoptimer(struct sim *s, int AorB)
 /* A or B is trying to stop timer */
 {
   struct event *q;
 
-  if (TRACE>1)
-    printf("          STOP TIMER: stopping timer at %f\n",time);
-  /* for (q=evlist; q!=NULL && q->next!=NULL; q = q->next)  */
-  for (q=evlist; q!=NULL ; q = q->next) 
-    if ( (q->evtype==TIMER_INTERRUPT  && q->eventity==AorB) ) { 
-      /* remove this event */
-      if (q->next==NULL && q->prev==NULL)
-        evlist=NULL;         /* remove first and only event on list */
-      else if (q->next==NULL) /* end of list - there is one in front */
-        q->prev->next = NULL;
-      else if (q==evlist) { /* front of list - there must be event after */
-        q->next->prev=NULL;
-        evlist = q->next;
-      }
-      else {     /* middle of list */
-        q->next->prev = q->prev;
-        q->prev->next =  q->next;
-      }
-      free(q);
-      return;
-    }
+  TRACE(s, 2, TR_STOPTIMER, AorB);
+  q = s->timers[AorB];
+  if (q != NULL) {
+    /* the event stays queued and is discarded when it reaches the head */
+    q->cancelled = 1;
+    s->timers[AorB] = NULL;
+    return;
+  }
   printf("Warning: unable to cancel your timer. It wasn't running.\n");
 }
 
 
-void starttimer(int AorB, double increment)
+double simtime(const struct sim *s)
+{
+  return s->time;
+}
+
+void starttimer(struct sim *s, int AorB, double increment)
 /* A or B is trying to start timer */
 {
 
-  struct event *q;
   struct event *evptr;
 
-  if (TRACE>1)
-    printf("          START TIMER: starting timer at %f\n",time);
+  TRACE(s, 2, TR_STARTTIMER, AorB);
   /* be nice: check to see if timer is already started, if so, then  warn */
-  /* for (q=evlist; q!=NULL && q->next!=NULL; q = q->next)  */
-  for (q=evlist; q!=NULL ; q = q->next)  
-    if ( (q->evtype==TIMER_INTERRUPT  && q->eventity==AorB) ) { 
-      printf("Warning: attempt to start a timer that is already started\n");
-      return;
-    }
+  if (s->timers[AorB] != NULL) {
+    printf("Warning: attempt to start a timer that is already started\n");
+    return;
+  }
  
   /* create future event for when timer goes off */
-  evptr = malloc(sizeof(struct event));
-  if (evptr == 0) {
-    printf("memory allocation for event failed.");
-    exit(EXIT_FAILURE);
-  }
-  evptr->evtime =  time + increment;
+  evptr = pool_alloc(&s->eventpool);
+  evptr->evtime =  s->time + increment;
   evptr->evtype =  TIMER_INTERRUPT;
    
  
   evptr->eventity = AorB;
-  insertevent(evptr);
+  insertevent(s, evptr);
+  s->timers[AorB] = evptr;
 } 
 
 
+/* number of packets currently in the medium on their way to A or B */
+int channel_inflight(const struct sim *s, int AorB)
+{
+  return s->channels[AorB].inflight;
+}
+
+/* largest number of packets that were in flight to A or B at once */
+int channel_maxinflight(const struct sim *s, int AorB)
+{
+  return s->channels[AorB].maxinflight;
+}
+
+/********************** PACKET BUFFERS ***********************/
+
+struct pkt *pkt_alloc(struct sim *s)
+{
+  struct pktbuf *b = pool_alloc(&s->pktpool);
+
+  b->refs = 1;
+  b->pkt.length = 0;
+  return &b->pkt;
+}
+
+void pkt_hold(const struct pkt *p)
+{
+  PKTBUF(p)->refs++;
+}
+
+void pkt_release(struct sim *s, const struct pkt *p)
+{
+  struct pktbuf *b = PKTBUF(p);
+
+  if (--b->refs == 0)
+    pool_free(&s->pktpool, b);
+}
+
+struct pkt *pkt_writable(struct sim *s, struct pkt *p)
+{
+  struct pkt *copy;
+
+  if (PKTBUF(p)->refs == 1)
+    return p;
+  copy = pkt_alloc(s);
+  pktcopy(copy, p);
+  s->stats.bytes_copied += p->length;
+  pkt_release(s, p);
+  return copy;
+}
+
+void pktcopy(struct pkt *dst, const struct pkt *src)
+{
+  memcpy(dst, src, offsetof(struct pkt, payload) + src->length);
+}
+
+/* the packet that holds the message's data: the emulator builds every
+   message in a packet buffer, so the sender only adds the header */
+struct pkt *msg_packet(const struct msg *m)
+{
+  pkt_hold(m->buffer);
+  return m->buffer;
+}
+
 /************************** TOLAYER3 ***************/
-void tolayer3(int AorB, struct pkt packet)
-/* A or B is sending to network  */
+static void checkmtu(const struct sim *s, const struct pkt *packet)
 {
-  struct pkt *mypktptr;
-  struct event *evptr,*q;
-  float lastime, x;
-  int i;
+  if (packet->length < 0 || packet->length > s->cfg.mtu) {
+    printf("INTERNAL PANIC: packet of %d bytes exceeds the MTU of %d\n", packet->length, s->cfg.mtu);
+    exit(EXIT_FAILURE);
+  }
+}
+
+/* the random part of the delay of a packet AorB is sending */
+static double jitter(struct sim *s, int AorB)
+{
+  double x = packetrand(s, RNG_DELAY, AorB, 0);
+
+  if (s->cfg.jitterdist == JITTER_EXPONENTIAL)
+    return -s->cfg.jitter / 2 * log(fmax(1.0 - x, 1e-12));
+  return s->cfg.jitter*x;
+}
 
-  ntolayer3++;
+/* send a packet the caller has handed one reference of to the network */
+static void transmit(struct sim *s, int AorB, struct pkt *mypktptr)
+{
+  struct pkt *copy;
+  struct event *evptr;
+  struct channel *ch = &s->channels[(AorB+1) % 2];
+  float lastime, x;
+  double sent = 0.0;
+  int corruptdirection = s->cfg.corruptdirection;
+
+  s->stats.ntolayer3++;
+  s->stats.nsent[AorB]++;
+
+  /* a lost packet has been sent all the same, it takes up the link */
+  if (s->cfg.bandwidth > 0.0 &&
+      (sent = link_send(s, &ch->link, AorB, mypktptr->length)) < 0.0) {
+    s->stats.link_drops++;
+    TRACE_VALUE(s, 1, TR_QUEUEDROP, AorB, ch->link.count);
+    pkt_release(s, mypktptr);
+    return;
+  }
 
   /* simulate losses: */
-  if (jimsrand() < lossprob && (!(AorB == B && corruptdirection == A) && !(AorB == A && corruptdirection == B))) {
-    nlost++;
-    if (TRACE>0)    
-      printf("          TOLAYER3: packet being lost\n");
+  if (packetrand(s, RNG_LOSS, AorB, 0) < s->cfg.lossprob && (!(AorB == B && corruptdirection == A) && !(AorB == A && corruptdirection == B))) {
+    s->stats.nlost++;
+    TRACE(s, 1, TR_LOST, AorB);
+    pkt_release(s, mypktptr);
     return;
   }  
 
-  /* make a copy of the packet student just gave me since he/she may decide */
-  /* to do something with the packet after we return back to him/her */ 
-  mypktptr = malloc(sizeof(struct pkt));
-  if (mypktptr == 0) {
-    printf("memory allocation for event failed.");
-    exit(EXIT_FAILURE);
-  }
-  mypktptr->seqnum = packet.seqnum;
-  mypktptr->acknum = packet.acknum;
-  mypktptr->checksum = packet.checksum;
-  for (i=0; i<20; i++)
-    mypktptr->payload[i] = packet.payload[i];
-  if (TRACE>2)  {
-    printf("          TOLAYER3: seq: %d, ack %d, check: %d ", mypktptr->seqnum,
-           mypktptr->acknum,  mypktptr->checksum);
-    for (i=0; i<20; i++)
-      printf("%c",mypktptr->payload[i]);
-    printf("\n");
-  }
+  TRACE_PKT(s, 3, TR_TOLAYER3, AorB, mypktptr);
 
   /* create future event for arrival of packet at the other side */
-  evptr = malloc(sizeof(struct event));
-  if (evptr == 0) {
-    printf("memory allocation for event failed.");
-    exit(EXIT_FAILURE);
-  }
+  evptr = pool_alloc(&s->eventpool);
   evptr->evtype =  FROM_LAYER3;   /* packet will pop out from layer3 */
   evptr->eventity = (AorB+1) % 2; /* event occurs at other entity */
   evptr->pktptr = mypktptr;       /* save ptr to my copy of packet */
   /* finally, compute the arrival time of packet at the other end.
      medium can not reorder, so make sure packet arrives between 1 and 10
-     time units after the latest arrival time of packets
-     currently in the medium on their way to the destination */
-  lastime = time;
-  /* for (q=evlist; q!=NULL && q->next!=NULL; q = q->next) */
-  for (q=evlist; q!=NULL ; q = q->next) 
-    if ( (q->evtype==FROM_LAYER3  && q->eventity==evptr->eventity) ) 
-      lastime = q->evtime;
-  evptr->evtime =  lastime + 1 + 9*jimsrand();
+     time units (--delay and --jitter) after the latest arrival time of
+     packets currently in the medium on their way to the destination.
+     With a link, the delay starts when the packet is on the wire, and
+     only keeps it behind the one ahead of it */
+  if (s->cfg.bandwidth > 0.0) {
+    evptr->evtime = sent + s->cfg.delay + jitter(s, AorB);
+    if (ch->inflight > 0 && evptr->evtime < ch->tail)
+      evptr->evtime = ch->tail;
+  }
+  else {
+    lastime = s->time;
+    if (ch->inflight > 0)
+      lastime = ch->tail;
+    evptr->evtime =  lastime + s->cfg.delay + jitter(s, AorB);
+  }
+  ch->tail = evptr->evtime;
+  if (++ch->inflight > ch->maxinflight)
+    ch->maxinflight = ch->inflight;
  
 
 
   /* simulate corruption: */
-  if ((jimsrand() < corruptprob)  && (!(AorB == B && corruptdirection == A) && !(AorB == A && corruptdirection == B))) {
-    ncorrupt++;
-    if ( (x = jimsrand()) < .75)
-      mypktptr->payload[0]='Z';   /* corrupt payload */
+  if ((packetrand(s, RNG_CORRUPT, AorB, 0) < s->cfg.corruptprob)  && (!(AorB == B && corruptdirection == A) && !(AorB == A && corruptdirection == B))) {
+    s->stats.ncorrupt++;
+    /* copy on write: the sender may still hold the packet to resend it */
+    if (PKTBUF(mypktptr)->refs > 1) {
+      copy = pkt_alloc(s);
+      pktcopy(copy, mypktptr);
+      s->stats.bytes_copied += mypktptr->length;
+      pkt_release(s, mypktptr);
+      evptr->pktptr = mypktptr = copy;
+    }
+    if ( (x = packetrand(s, RNG_CORRUPT, AorB, 1)) < .75) {
+      if (mypktptr->length > 0)
+        mypktptr->payload[0]='Z';   /* corrupt payload */
+      else
+        mypktptr->checksum ^= 1;    /* an ACK has none, hit the checksum */
+    }
     else if (x < .875)
       mypktptr->seqnum = 999999;
     else
       mypktptr->acknum = 999999;
-    if (TRACE>0)    
-      printf("          TOLAYER3: packet being corrupted\n");
+    TRACE(s, 1, TR_CORRUPTED, AorB);
   }  
 
-  if (TRACE>2)  
-    printf("          TOLAYER3: scheduling arrival on other side\n");
-  insertevent(evptr);
+  TRACE(s, 3, TR_SCHEDULED, AorB);
+  insertevent(s, evptr);
 } 
 
-void tolayer5(int AorB, char datasent[20])
+void tolayer3(struct sim *s, int AorB, const struct pkt *packet)
+/* A or B is sending to network  */
 {
-  int i;  
-  if (TRACE>2) {
-    printf("          TOLAYER5: data received by application at ");
-    if (AorB == A) 
-      printf("A: ");
-    else
-      printf("B: ");
-    for (i=0; i<20; i++)  
-      printf("%c",datasent[i]);
-    printf("\n");
-  }
-  messages_delivered++;
+  struct pkt *mypktptr;
+
+  checkmtu(s, packet);
+  /* make a copy of the packet student just gave me since he/she may decide */
+  /* to do something with the packet after we return back to him/her */ 
+  mypktptr = pkt_alloc(s);
+  pktcopy(mypktptr, packet);
+  s->stats.bytes_copied += packet->length;
+  transmit(s, AorB, mypktptr);
 }
 
-int main(void)
+void tolayer3_shared(struct sim *s, int AorB, struct pkt *packet)
+{
+  checkmtu(s, packet);
+  pkt_hold(packet);
+  transmit(s, AorB, packet);
+}
+
+void tolayer5(struct sim *s, int AorB, const char *datasent, int length)
+{
+  TRACE_DATA(s, 3, TR_TOLAYER5, AorB, datasent, length);
+  s->stats.messages_delivered++;
+  s->stats.delivered[AorB]++;
+  s->stats.bytes_delivered += length;
+  message_delivered(s, (AorB+1) % 2, datasent, length);
+}
+
+/********************** MAIN LOOP ***********************/
+
+void sim_run(struct sim *s)
 {
   struct event *eventptr;
   struct msg  msg2give;
-  struct pkt  pkt2give;
+  struct pkt *msgbuf;
    
-  int i,j;
+  int refused;
   
-  init();
-  A_init();
-  B_init();
-   
   while (1) {
-    eventptr = evlist;            /* get next event to simulate */
-    if (eventptr==NULL)
-      goto terminate;
-    evlist = evlist->next;        /* remove this event from event list */
-    if (evlist!=NULL)
-      evlist->prev=NULL;
-    if (TRACE>=2) {
-      printf("\nEVENT time: %f,",eventptr->evtime);
-      printf("  type: %d",eventptr->evtype);
-      if (eventptr->evtype==0)
-        printf(", timerinterrupt  ");
-      else if (eventptr->evtype==1)
-        printf(", fromlayer5 ");
-      else
-        printf(", fromlayer3 ");
-      printf(" entity: %d\n",eventptr->eventity);
+    eventptr = sched_pop(&s->evlist);  /* get next event to simulate */
+    if (eventptr==NULL) {
+      /* the messages still queued count until the end */
+      s->stats.queue_area += s->stats.queue_depth * (s->time - s->stats.queue_changed);
+      return;
+    }
+    if (eventptr->cancelled) {      /* timer stopped after it was queued */
+      pool_free(&s->eventpool, eventptr);
+      continue;
     }
-    time = eventptr->evtime;        /* update time to next event time */
+    TRACE_EVENT(s, 2, eventptr);
+    s->stats.events++;
+    s->time = eventptr->evtime;     /* update time to next event time */
     if (eventptr->evtype == FROM_LAYER5 ) {
-      if (nsim < nsimmax) {
-        generate_next_arrival();   /* set up future arrival */
-        /* fill in msg to give with string of same letter */    
-        j = nsim % 26; 
-        for (i=0; i<20; i++)  
-          msg2give.data[i] = 97 + j;
-        if (TRACE>2) {
-          printf("          MAINLOOP: data given to student: ");
-          for (i=0; i<20; i++) 
-            printf("%c", msg2give.data[i]);
-          printf("\n");
-        }
-        nsim++;
+      if (s->nsim < s->cfg.nsimmax) {
+        generate_next_arrival(s);  /* set up future arrival */
+        /* fill in msg to give with string of same letter, see msg_fill() */    
+        msgbuf = pkt_alloc(s);
+        msgbuf->length = s->cfg.msgsize;
+        msg_fill(msgbuf->payload, msgbuf->length, s->nsim);
+        msg2give.length = msgbuf->length;
+        msg2give.data = msgbuf->payload;
+        msg2give.buffer = msgbuf;
+        TRACE_DATA(s, 3, TR_GIVEN, eventptr->eventity, msg2give.data, msg2give.length);
+        s->nsim++;
+        s->stats.given[eventptr->eventity]++;
+        refused = s->stats.window_full;
         if (eventptr->eventity == A) 
-          A_output(msg2give);  
+          s->proto->A_output(s, &msg2give);  
         else
-          B_output(msg2give);  
+          s->proto->B_output(s, &msg2give);  
+        /* protocols count the messages they do not accept in window_full */
+        if (s->stats.window_full == refused)
+          message_sent(s, eventptr->eventity);
+        pkt_release(s, msgbuf);
       }
-      else if (TRACE > 2)
-          printf("          FROM_LAYER5: no more messages to send: \n");
+      else
+        TRACE(s, 3, TR_NOMORE, eventptr->eventity);
     }
     else if (eventptr->evtype ==  FROM_LAYER3) {
-      pkt2give.seqnum = eventptr->pktptr->seqnum;
-      pkt2give.acknum = eventptr->pktptr->acknum;
-      pkt2give.checksum = eventptr->pktptr->checksum;
-      for (i=0; i<20; i++)  
-        pkt2give.payload[i] = eventptr->pktptr->payload[i];
+      /* the entities get our reference, pkt_hold() it to keep the packet */
 	    if (eventptr->eventity ==A)      /* deliver packet by calling */
-        A_input(pkt2give);            /* appropriate entity */
+        s->proto->A_input(s, eventptr->pktptr);   /* appropriate entity */
       else
-        B_input(pkt2give);
-	    free(eventptr->pktptr);          /* free the memory for packet */
+        s->proto->B_input(s, eventptr->pktptr);
+	    pkt_release(s, eventptr->pktptr); /* free the memory for packet */
+      s->channels[eventptr->eventity].inflight--;
     }
     else if (eventptr->evtype ==  TIMER_INTERRUPT) {
+      s->timers[eventptr->eventity] = NULL;
       if (eventptr->eventity == A) 
-        A_timerinterrupt();
+        s->proto->A_timerinterrupt(s);
       else
-        B_timerinterrupt();
+        s->proto->B_timerinterrupt(s);
     }
     else  {
       printf("INTERNAL PANIC: unknown event type \n");
     }
-    free(eventptr);
+    pool_free(&s->eventpool, eventptr);
   }
+}
+
+static double goodput(const struct sim *s)
+{
+  return s->time > 0.0 ? s->stats.messages_delivered / s->time : 0.0;
+}
+
+static double bytegoodput(const struct sim *s)
+{
+  return s->time > 0.0 ? s->stats.bytes_delivered / s->time : 0.0;
+}
+
+/* in full duplex mode the resends of both directions over their data
+   packets */
+static double overhead(const struct sim *s)
+{
+  int first = s->stats.nsent[A] - s->stats.packets_resent;
 
- terminate:
-  printf(" Simulator terminated at time %f\n after attempting to send %d msgs from layer5\n",time,nsim);
-  printf("number of messages dropped due to full window:  %d \n", window_full);
-  printf("number of valid (not corrupt or duplicate) acknowledgements received at A:  %d \n", new_ACKs);
+  if (s->cfg.bidirectional)
+    first += s->stats.nsent[B] - s->stats.pure_acks[A] - s->stats.pure_acks[B];
+  return first > 0 ? (double)s->stats.packets_resent / first : 0.0;
+}
+
+static double queuedepth(const struct sim *s)
+{
+  return s->time > 0.0 ? s->stats.queue_area / s->time : 0.0;
+}
+
+/* the share of the packets piggybacking saved: without it, each ACK
+   carried by data would have been a packet of its own */
+static double piggybacksaving(const struct sim *s)
+{
+  int carried = s->stats.piggybacked[A] + s->stats.piggybacked[B];
+  int sent = s->stats.nsent[A] + s->stats.nsent[B];
+
+  return sent + carried > 0 ? (double)carried / (sent + carried) : 0.0;
+}
+
+void sim_printsummary(const struct sim *s)
+{
+  int i;
+
+  printf(" Simulator terminated at time %f\n after attempting to send %d msgs from layer5\n",s->time,s->nsim);
+  printf("number of messages dropped due to full window:  %d \n", s->stats.window_full);
+  printf("number of valid (not corrupt or duplicate) acknowledgements received at A:  %d \n", s->stats.new_ACKs);
   printf("(note: a single acknowledgement may have acknowledged more than one packet - if cumulative acknowledgements are used)\n");
-  printf("number of packet resends by A:  %d \n", packets_resent);
-  printf("number of correct packets received at B:  %d \n", packets_received);
-  printf("number of messages delivered to application:  %d \n", messages_delivered);
+  printf("number of packet resends by A:  %d \n", s->stats.packets_resent);
+  if (s->cfg.sack)
+    printf("number of packets ACKed without their own ACK (SACK):  %d \n", s->stats.acks_saved);
+  if (s->cfg.dupacks > 0)
+    printf("number of fast retransmits:  %d (%d packets; %d resent on timeouts) \n", s->stats.fast_retransmits,
+           s->stats.fast_resends, s->stats.packets_resent - s->stats.fast_resends);
+  if (s->cfg.sendq > 0) {
+    printf("number of messages queued while the window was full:  %d (%d dropped by a full queue, %d beyond it) \n",
+           s->stats.queued, s->stats.queue_drops, s->stats.backpressure);
+    printf("send queue depth: mean %f, max %d \n", queuedepth(s), s->stats.queue_max);
+    printf("queueing delay: mean %f, p50 %f, p99 %f, max %f \n", hdr_mean(&s->queuedelay),
+           hdr_percentile(&s->queuedelay, 50.0), hdr_percentile(&s->queuedelay, 99.0), s->queuedelay.max);
+  }
+  printf("number of spurious resends (ACKed sooner than a round trip after the resend):  %d \n", s->stats.spurious_resends);
+  printf("number of correct packets received at B:  %d \n", s->stats.packets_received);
+  printf("number of messages delivered to application:  %d \n", s->stats.messages_delivered);
+  if (s->cfg.bidirectional) {
+    for (i = A; i <= B; i++)
+      printf("direction %c->%c: %d messages given, %d delivered, %d data packets, %d pure ACKs and %d piggybacked ACKs back \n",
+             "AB"[i], "AB"[1 - i], s->stats.given[i], s->stats.delivered[1 - i], s->stats.nsent[i] - s->stats.pure_acks[i],
+             s->stats.pure_acks[1 - i], s->stats.piggybacked[1 - i]);
+    printf("piggybacking: %d ACKs carried by data, %.1f%% fewer packets \n",
+           s->stats.piggybacked[A] + s->stats.piggybacked[B], 100.0 * piggybacksaving(s));
+  }
+  else
+    printf("number of packets sent by B (ACKs):  %d \n", s->stats.nsent[B]);
+  if (s->cfg.bandwidth > 0.0)
+    printf("number of packets dropped by the link queues:  %d (%d lost at random), max queue %d \n",
+           s->stats.link_drops, s->stats.nlost, s->stats.link_queue_max);
+  printf("number of events processed:  %ld \n", s->stats.events);
+  printf("message latency: mean %f, p50 %f, p90 %f, p99 %f, p99.9 %f, max %f \n",
+         hdr_mean(&s->latency), hdr_percentile(&s->latency, 50.0), hdr_percentile(&s->latency, 90.0),
+         hdr_percentile(&s->latency, 99.0), hdr_percentile(&s->latency, 99.9), s->latency.max);
+  printf("goodput (messages delivered per time unit):  %f \n", goodput(s));
+  printf("goodput (bytes delivered per time unit):  %f \n", bytegoodput(s));
+  printf("retransmission overhead (resends per new packet sent by A):  %f \n", overhead(s));
+  if (s->cfg.pooldebug) {
+    printf("event pool: %ld allocations, peak %ld in use, %ld slots\n",
+           s->eventpool.allocs, s->eventpool.peak, s->eventpool.capacity);
+    printf("packet pool: %ld allocations, peak %ld in use, %ld slots\n",
+           s->pktpool.allocs, s->pktpool.peak, s->pktpool.capacity);
+  }
+}
+
+/* machine readable version of the summary (the parameters are added
+   by config_report) */
+void sim_report(const struct sim *s, struct report *r)
+{
+  report_real(r, "time", s->time);
+  report_int(r, "messages_sent", s->nsim);
+  report_int(r, "window_full", s->stats.window_full);
+  report_int(r, "total_ACKs_received", s->stats.total_ACKs_received);
+  report_int(r, "new_ACKs", s->stats.new_ACKs);
+  report_int(r, "packets_resent", s->stats.packets_resent);
+  report_int(r, "spurious_resends", s->stats.spurious_resends);
+  report_int(r, "fast_retransmits", s->stats.fast_retransmits);
+  report_int(r, "fast_resends", s->stats.fast_resends);
+  report_int(r, "timeout_resends", s->stats.packets_resent - s->stats.fast_resends);
+  report_int(r, "acks_saved", s->stats.acks_saved);
+  report_int(r, "queued", s->stats.queued);
+  report_int(r, "queue_drops", s->stats.queue_drops);
+  report_int(r, "backpressure", s->stats.backpressure);
+  report_int(r, "queue_max", s->stats.queue_max);
+  report_real(r, "queue_mean", queuedepth(s));
+  report_real(r, "queue_delay_mean", hdr_mean(&s->queuedelay));
+  report_real(r, "queue_delay_p99", hdr_percentile(&s->queuedelay, 99.0));
+  report_int(r, "packets_received", s->stats.packets_received);
+  report_int(r, "messages_delivered", s->stats.messages_delivered);
+  report_int(r, "tolayer3", s->stats.ntolayer3);
+  report_int(r, "sent_by_A", s->stats.nsent[A]);
+  report_int(r, "sent_by_B", s->stats.nsent[B]);
+  report_int(r, "given_to_A", s->stats.given[A]);
+  report_int(r, "given_to_B", s->stats.given[B]);
+  report_int(r, "delivered_to_A", s->stats.delivered[A]);
+  report_int(r, "delivered_to_B", s->stats.delivered[B]);
+  report_int(r, "pure_acks_by_A", s->stats.pure_acks[A]);
+  report_int(r, "pure_acks_by_B", s->stats.pure_acks[B]);
+  report_int(r, "piggybacked_by_A", s->stats.piggybacked[A]);
+  report_int(r, "piggybacked_by_B", s->stats.piggybacked[B]);
+  report_real(r, "piggyback_saving", piggybacksaving(s));
+  report_int(r, "events_processed", s->stats.events);
+  report_int(r, "lost", s->stats.nlost);
+  report_int(r, "link_drops", s->stats.link_drops);
+  report_int(r, "link_queue_max", s->stats.link_queue_max);
+  report_int(r, "corrupted", s->stats.ncorrupt);
+  report_int(r, "max_inflight_to_A", s->channels[A].maxinflight);
+  report_int(r, "max_inflight_to_B", s->channels[B].maxinflight);
+  report_int(r, "peak_events", s->eventpool.peak);
+  report_int(r, "peak_packets", s->pktpool.peak);
+  report_real(r, "goodput", goodput(s));
+  report_int(r, "bytes_delivered", s->stats.bytes_delivered);
+  report_int(r, "bytes_copied", s->stats.bytes_copied);
+  report_real(r, "goodput_bytes", bytegoodput(s));
+  report_real(r, "retransmission_overhead", overhead(s));
+  report_real(r, "latency_mean", hdr_mean(&s->latency));
+  report_real(r, "latency_p50", hdr_percentile(&s->latency, 50.0));
+  report_real(r, "latency_p90", hdr_percentile(&s->latency, 90.0));
+  report_real(r, "latency_p99", hdr_percentile(&s->latency, 99.0));
+  report_real(r, "latency_p999", hdr_percentile(&s->latency, 99.9));
+  report_real(r, "latency_max", s->latency.max);
+}
+
+int main(int argc, char **argv)
+{
+  struct simconfig config;
+  struct report r;
+  struct sim *s;
+
+  config_parse(&config, argc, argv);
+  if (config.sweep != NULL)
+    return sweep_run(&config) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+  printf("-----  Stop and Wait Network Simulator Version 1.1 -------- \n\n");
+  config_prompt(&config);      /* ask for anything not on the command line */
+  if (config.compare != NULL)   /* each protocol gets its own defaults */
+    return compare_run(&config) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  if (sim_configure(&config) != 0)
+    return EXIT_FAILURE;
+  sim_warn(&config);
+
+  s = sim_create(&config);
+  sim_run(s);
+  sim_printsummary(s);
+  if (config.report != NULL) {
+    report_init(&r);
+    config_report(&s->cfg, &r);
+    sim_report(s, &r);
+    if (report_save(&r, config.report, config.reportformat) != 0)
+      exit(EXIT_FAILURE);
+  }
+  sim_destroy(s);
   return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
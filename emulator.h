@@ -1,40 +1,204 @@
-extern int TRACE;
+#ifndef EMULATOR_H
+#define EMULATOR_H
 
-/* statistics updated by GBN */
-extern int total_ACKs_received;
-extern int packets_resent;       /* count of the number of packets resent  */
-extern int new_ACKs;      /* count of the number of acks correctly received */
-extern int packets_received;  /* count of the packets received by receiver */
-extern int window_full; /* count of the number of messages dropped due to full window */
+#include <stdio.h>
+#include "config.h"
+#include "scheduler.h"
+#include "pool.h"
+#include "rng.h"
+#include "hdr.h"
+#include "link.h"
 
 #define   A    0
 #define   B    1
 
+#define MAXPAYLOAD 9000   /* largest message and packet payload (jumbo frame) */
+
 /* a "msg" is the data unit passed from layer 5 (teachers code) to layer  */
 /* 4 (students' code).  It contains the data (characters) to be delivered */
 /* to layer 5 via the students transport level protocol entities.         */
+/* It has length bytes (--msgsize), held in the payload of a packet       */
+/* buffer the sender can send without copying them, see msg_packet().     */
 struct msg {
-  char data[20];
+  int length;
+  const char *data;
+  struct pkt *buffer;
 };
 
 /* a packet is the data unit passed from layer 4 (students code) to layer */
 /* 3 (teachers code).  Note the pre-defined packet structure, which all   */
-/* students must follow. */
+/* students must follow.  Only the first length bytes of the payload are */
+/* used; length may not exceed the MTU (--mtu) and is covered by the      */
+/* checksum.  Copy packets with pktcopy(), which skips the unused bytes.  */
 struct pkt {
   int seqnum;
   int acknum;
   int checksum;
-  char payload[20];
+  int length;
+  char payload[MAXPAYLOAD];
+};
+
+/* statistics of one simulation */
+struct stats {
+  /* updated by GBN/SR */
+  int window_full;          /* count of the number of messages dropped due to full window */
+  int total_ACKs_received;
+  int packets_resent;       /* count of the number of packets resent  */
+  int new_ACKs;             /* count of the number of acks correctly received */
+  int packets_received;     /* count of the packets received by receiver */
+  int spurious_resends;     /* resends whose packet was ACKed before, see rto.h */
+  int acks_saved;           /* packets ACKed without their own ACK arriving (SACK) */
+  int fast_retransmits;     /* windows resent on duplicate ACKs (GBN --dupacks) */
+  int fast_resends;         /* packets of packets_resent resent by them */
+  int queued;               /* messages that waited in the send queue, see sendq.h */
+  int queue_drops;          /* messages of window_full refused by a full queue */
+  int backpressure;         /* messages queued beyond the limit */
+  int queue_max;            /* deepest the queue has been */
+  double queue_area;        /* queue depth integrated over time */
+  int queue_depth;          /* messages in the send queues now */
+  float queue_changed;      /* when queue_depth last changed */
+  int pure_acks[2];         /* ACK packets without data sent by A and B */
+  int piggybacked[2];       /* ACKs carried by data instead (--bidirectional) */
+
+  /* updated by emulator */
+  int messages_delivered;
+  int ntolayer3;            /* number sent into layer 3 */
+  int nlost;                /* number lost in media */
+  int ncorrupt;             /* number corrupted by media*/
+  int nsent[2];             /* packets sent into layer 3 by A and B */
+  int link_drops;           /* packets dropped by a full link queue, see link.h */
+  int link_queue_max;       /* most packets a link queue has held */
+  int given[2];             /* messages from layer 5 at A and B */
+  int delivered[2];         /* messages delivered to layer 5 at A and B */
+  long bytes_delivered;     /* message bytes delivered to layer 5 */
+  long bytes_copied;        /* payload bytes copied by the emulator */
+  long events;              /* events processed, not counting cancelled timers */
+};
+
+/* the medium towards each entity: packets are delivered in order, so
+   the arrival time of the last packet sent is all that tolayer3 needs,
+   besides the link with --bandwidth */
+struct channel {
+  float tail;          /* arrival time of the last packet in flight */
+  int inflight;        /* packets in flight towards this entity */
+  int maxinflight;     /* largest value inflight has reached */
+  struct link link;    /* bandwidth and queue, see link.h */
+};
+
+/* the messages an entity has accepted from layer 5 and not yet
+   delivered at the other side, oldest first */
+struct sentmsg {
+  float time;               /* when it was given to the sender */
+  int number;               /* its number in the run, see msg_fill() */
+  char delivered;
 };
 
+struct msgqueue {
+  struct sentmsg *msgs;
+  int first, count, size;
+};
+
+/* One simulation.  Everything the emulator and the protocol entities
+   keep between calls lives here, so any number of simulations can be
+   created, run and destroyed in the same process.  Protocol code only
+   uses trace (through the trace.h macros), stats and state. */
+struct tracelog;
+struct protocol;
+
+struct sim {
+  struct simconfig cfg;     /* parameters of this run */
+  int trace;                /* TRACE level */
+  struct tracelog *tracelog;   /* binary trace records, see trace.h */
+  FILE *cwndlog;            /* congestion window over time, see cc.h */
+  struct stats stats;
+  const struct protocol *proto; /* the protocol entities, see protocol.h */
+  void *state[2];           /* protocol state of A and B, see simalloc() */
+
+  /* emulator internals */
+  float time;
+  int nsim;                 /* number of messages from 5 to 4 so far */
+  struct scheduler evlist;  /* the pending events, see scheduler.h */
+  struct event *timers[2];  /* pending timer event of A and B, if any */
+  struct channel channels[2];   /* indexed by destination entity */
+  struct msgqueue pending[2];   /* indexed by sending entity */
+  struct hdr latency;       /* layer 5 to layer 5 delay of each message */
+  struct hdr queuedelay;    /* time messages waited in A's send queue */
+  struct pool eventpool;    /* events and packet copies are recycled */
+  struct pool pktpool;      /* through pools, see pool.h */
+  struct rng rng;           /* random numbers for this run only */
+  struct allocation *allocations;   /* memory handed out by simalloc() */
+};
+
+/* fill in the protocol's defaults and check the parameters against its
+   rules, returns 0 if they are usable */
+extern int sim_configure(struct simconfig *);
+
+/* print what usable parameters will not give as asked, once per run
+   or comparison from the command line */
+extern void sim_warn(const struct simconfig *);
+
+/* create a simulation for the given (complete) parameters, run it until
+   no events are left, and release everything it owns */
+extern struct sim *sim_create(const struct simconfig *);
+extern void sim_run(struct sim *);
+extern void sim_destroy(struct sim *);
+
+/* print the end-of-run summary, or add its counters to a machine
+   readable report (config_report adds the parameters) */
+extern void sim_printsummary(const struct sim *);
+extern void sim_report(const struct sim *, struct report *);
+
+/* zeroed memory owned by the simulation, released by sim_destroy() */
+extern void *simalloc(struct sim *, size_t);
+
+/* release memory from simalloc() before sim_destroy() */
+extern void simfree(struct sim *, void *);
+
 /* send to A or B (int), packet to send */
-extern void tolayer3(int, struct pkt);  
+extern void tolayer3(struct sim *, int, const struct pkt *);
+
+/* deliver to A or B (int), data to deliver and its length */
+extern void tolayer5(struct sim *, int, const char *, int);
+
+/* copy the header and the used part of the payload of a packet */
+extern void pktcopy(struct pkt *, const struct pkt *);
 
-/* deliver to A or B (int), data to deliver */
-extern void tolayer5(int, char[20]); 
+/* reference counted packets with room for the MTU: pkt_alloc() returns
+   one with a single reference, pkt_hold() adds one and pkt_release()
+   drops one, the last frees the packet */
+extern struct pkt *pkt_alloc(struct sim *);
+extern void pkt_hold(const struct pkt *);
+extern void pkt_release(struct sim *, const struct pkt *);
+
+/* a packet the caller may change: the packet itself if the caller's
+   reference is the only one, else a copy, and the caller's reference
+   moves to the result */
+extern struct pkt *pkt_writable(struct sim *, struct pkt *);
+
+/* a new reference to the packet buffer holding a message's data, for
+   the sender to fill in the header */
+extern struct pkt *msg_packet(const struct msg *);
+
+/* send a packet from pkt_alloc() without copying it; the network keeps
+   its own reference, so the sender must not change the packet after
+   this, but can send it again */
+extern void tolayer3_shared(struct sim *, int, struct pkt *);
+
+/* the current simulation time */
+extern double simtime(const struct sim *);
+
+/* a uniform random number in [0,1] of a purpose (RNG_*) for the packet
+   AorB is sending, draw 0-3 of that packet with --crn */
+extern double packetrand(struct sim *, int purpose, int AorB, int draw);
 
 /* start timer at A or B (int), increment */
-extern void starttimer(int, double);       
+extern void starttimer(struct sim *, int, double);
 
 /* stop timer at A or B (int) */
-extern void stoptimer(int);               
+extern void stoptimer(struct sim *, int);
+
+/* packets currently in flight to A or B (int), and the peak of that count */
+extern int channel_inflight(const struct sim *, int);
+extern int channel_maxinflight(const struct sim *, int);
+
+#endif
@@ -1,8 +1,16 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <limits.h>
 #include "emulator.h"
 #include "gbn.h"
+#include "checksum.h"
+#include "trace.h"
+#include "modulus.h"
+#include "rto.h"
+#include "cc.h"
+#include "sendq.h"
+#include "timer.h"
 
 /* ******************************************************************
    Go Back N protocol.  Adapted from J.F.Kurose
@@ -20,255 +28,535 @@
    - removed bidirectional GBN code and other code not used by prac. 
    - fixed C style to adhere to current programming style
    - added GBN implementation
+   - optional fast retransmit (--dupacks n): n duplicates of the last
+   cumulative ACK resend the window at once instead of waiting for the
+   timer; further duplicates are ignored until a new ACK arrives.
+   - optional delayed ACKs (--delack): B acknowledges every k-th
+   packet received in order, or when its timer goes off, and at once
+   when a packet is out of order or corrupted.
+   - optional congestion control (--cc): the window in use is the
+   smaller of the fixed window and cwnd, which timeouts and fast
+   retransmits reduce.
+   - full duplex (--bidirectional): both entities send and receive.
+   The A_ routines are the sending half and the B_ routines the
+   receiving half of either entity.  Data packets carry the ACK for
+   the other direction in acknum; an ACK is held back for --delack-time
+   and only sent on its own (seqnum NOTINUSE) if no data leaves in the
+   meantime.
 **********************************************************************/
 
+/* defaults of the run time parameters (--rtt, --window, --seqspace) */
 #define RTT  16.0       /* round trip time.  MUST BE SET TO 16.0 when submitting assignment */
 #define WINDOWSIZE 6    /* the maximum number of buffered unacked packet */
-#define SEQSPACE 7      /* the min sequence space for GBN must be at least windowsize + 1 */
 #define NOTINUSE (-1)   /* used to fill header fields that are not being used */
 
-/* generic procedure to compute the checksum of a packet.  Used by both sender and receiver  
-   the simulator will overwrite part of your packet with 'z's.  It will not overwrite your 
-   original checksum.  This procedure must generate a different checksum to the original if
-   the packet is corrupted.
-*/
-int ComputeChecksum(struct pkt packet)
+static int configure(struct simconfig *cfg)
 {
-  int checksum = 0;
-  int i;
+  if (cfg->windowsize == 0)
+    cfg->windowsize = WINDOWSIZE;
+  if (cfg->seqspace == 0)
+    cfg->seqspace = cfg->windowsize + 1;
+  if (cfg->rtt == 0.0)
+    cfg->rtt = RTT;
+  /* the min sequence space for GBN must be at least windowsize + 1 */
+  if (cfg->windowsize < 1 || cfg->seqspace < cfg->windowsize + 1) {
+    printf("GBN needs a sequence space of at least window + 1 (window %d, seqspace %d)\n",
+           cfg->windowsize, cfg->seqspace);
+    return -1;
+  }
+  if (cfg->sack) {
+    printf("GBN only has cumulative ACKs, --sack is for SR\n");
+    return -1;
+  }
+  if (cfg->timers == TIMERS_PACKET) {
+    printf("GBN resends the whole window on one timer, --timers packet is for SR\n");
+    return -1;
+  }
+  return 0;
+}
+
+/* protocol state of an entity, kept in the simulation as s->state[A]
+   and s->state[B]: A sends and B receives, or both do both */
+struct sender;
+struct receiver;
+
+struct entity {
+  int entity;                     /* A or B */
+  bool duplex;                    /* --bidirectional */
+  struct timers timers;           /* shared by the two halves */
+  struct sender *snd;             /* sending half, if any */
+  struct receiver *rcv;           /* receiving half, if any */
+};
+
+static int B_piggyback(struct sim *, struct receiver *);
+
+/********* Sender (A) variables and functions ************/
+
+/* sender state, the sending half of an entity */
+struct sender {
+  int entity;                     /* A, or B in full duplex mode */
+  struct timers *timers;          /* the entity's timers */
+  struct receiver *rcv;           /* the receiving half in full duplex mode, else NULL */
+
+  struct pkt **buffer;            /* array for storing packets waiting for ACK */
+  struct rtosend *sends;          /* when each of them was sent, same indexes */
+  int windowfirst, windowlast;    /* array indexes of the first/last packet awaiting ACK */
+  int windowcount;                /* the number of packets currently awaiting an ACK */
+  int A_nextseqnum;               /* the next sequence number to be used by the sender */
+
+  int windowsize;                 /* the maximum number of buffered unacked packet */
+  struct modulus window;          /* wraps buffer indexes */
+  struct modulus seqspace;        /* wraps sequence numbers */
+  struct rto rto;                 /* retransmission timeout */
+  struct sendq sendq;             /* messages waiting for room in the window */
+  struct cc cc;                   /* congestion window */
+
+  /* fast retransmit (--dupacks) */
+  int dupthresh;                  /* duplicate ACKs that trigger it, 0 for never */
+  int dupcount;                   /* duplicates of the last ACK so far */
+  bool recovering;                /* resent on duplicates, waiting for a new ACK */
+};
+
+/* resend the packet in window slot i; in full duplex mode it carries
+   the latest ACK for the other direction, not the one it was sent with */
+static void A_resend(struct sim *s, struct sender *a, int i)
+{
+  if (a->rcv != NULL) {
+    a->buffer[i] = pkt_writable(s, a->buffer[i]);
+    a->buffer[i]->acknum = B_piggyback(s, a->rcv);
+    a->buffer[i]->checksum = ComputeChecksum(s, a->buffer[i]);
+  }
 
-  checksum = packet.seqnum;
-  checksum += packet.acknum;
-  for ( i=0; i<20; i++ ) 
-    checksum += (int)(packet.payload[i]);
+  TRACE_PKT(s, 1, TR_A_RESEND, a->entity, a->buffer[i]);
 
-  return checksum;
+  tolayer3_shared(s, a->entity, a->buffer[i]);
+  rto_resent(&a->sends[i], simtime(s));
+  s->stats.packets_resent++;
 }
 
-bool IsCorrupted(struct pkt packet)
+/* resend every packet in the window and restart the timer */
+static void A_goback(struct sim *s, struct sender *a)
 {
-  if (packet.checksum == ComputeChecksum(packet))
-    return (false);
-  else
-    return (true);
+  int i;
+
+  for(i=0; i<a->windowcount; i++) {
+    A_resend(s, a, wrap(&a->window, a->windowfirst+i));
+    if (i==0) timers_start(s, a->timers, TIMER_RETRANSMIT, rto_current(&a->rto));
+  }
 }
 
+/* an ACK for the packet before the window: the receiver got a packet
+   out of order, so one before it was probably lost */
+static void A_dupack(struct sim *s, struct sender *a)
+{
+  TRACE(s, 1, TR_A_DUPACK, a->entity);
+  if (a->recovering || ++a->dupcount < a->dupthresh)
+    return;
+  TRACE_VALUE(s, 1, TR_A_FASTRETRANSMIT, a->entity, a->dupcount);
+  s->stats.fast_retransmits++;
+  s->stats.fast_resends += a->windowcount;
+  a->recovering = true;
+  a->dupcount = 0;
+  cc_loss(s, &a->cc);
+  timers_stop(s, a->timers, TIMER_RETRANSMIT);
+  A_goback(s, a);
+}
 
-/********* Sender (A) variables and functions ************/
+/* number the message's packet, buffer and send it */
+static void A_send(struct sim *s, struct sender *a, struct pkt *sendpkt)
+{
+  sendpkt->seqnum = a->A_nextseqnum;
+  sendpkt->acknum = a->rcv != NULL ? B_piggyback(s, a->rcv) : NOTINUSE;
+  sendpkt->checksum = ComputeChecksum(s, sendpkt); 
+
+  /* put packet in window buffer */
+  /* windowlast will always be 0 for alternating bit; but not for GoBackN */
+  a->windowlast = wrap(&a->window, a->windowlast + 1); 
+  a->buffer[a->windowlast] = sendpkt;
+  rto_sent(&a->sends[a->windowlast], simtime(s));
+  a->windowcount++;
+
+  /* send out packet, shared with the window buffer */
+  TRACE_PKT(s, 1, TR_A_SENDING, a->entity, sendpkt);
+  tolayer3_shared (s, a->entity, sendpkt);
+
+  /* start timer if first packet in window */
+  if (a->windowcount == 1)
+    timers_start(s, a->timers, TIMER_RETRANSMIT, rto_current(&a->rto));
+
+  /* get next sequence number, wrap back to 0 */
+  a->A_nextseqnum = wrap(&a->seqspace, a->A_nextseqnum + 1);  
+}
 
-static struct pkt buffer[WINDOWSIZE];  /* array for storing packets waiting for ACK */
-static int windowfirst, windowlast;    /* array indexes of the first/last packet awaiting ACK */
-static int windowcount;                /* the number of packets currently awaiting an ACK */
-static int A_nextseqnum;               /* the next sequence number to be used by the sender */
+/* send queued messages while the window has room */
+static void A_drain(struct sim *s, struct sender *a)
+{
+  while (sendq_count(&a->sendq) > 0 && a->windowcount < cc_window(&a->cc))
+    A_send(s, a, sendq_get(s, &a->sendq));
+}
 
-/* called from layer 5 (application layer), passed the message to be sent to other side */
-void A_output(struct msg message)
+/* a message from layer 5 (application layer) to be sent to other side */
+static void A_message(struct sim *s, struct sender *a, const struct msg *message)
 {
-  struct pkt sendpkt;
-  int i;
+  /* if not blocked waiting on ACK, or on messages queued before */
+  if (sendq_count(&a->sendq) == 0 && a->windowcount < cc_window(&a->cc)) {
+    TRACE(s, 2, TR_A_SENDNEW, a->entity);
 
-  /* if not blocked waiting on ACK */
-  if ( windowcount < WINDOWSIZE) {
-    if (TRACE > 1)
-      printf("----A: New message arrives, send window is not full, send new messge to layer3!\n");
-
-    /* create packet */
-    sendpkt.seqnum = A_nextseqnum;
-    sendpkt.acknum = NOTINUSE;
-    for ( i=0; i<20 ; i++ ) 
-      sendpkt.payload[i] = message.data[i];
-    sendpkt.checksum = ComputeChecksum(sendpkt); 
-
-    /* put packet in window buffer */
-    /* windowlast will always be 0 for alternating bit; but not for GoBackN */
-    windowlast = (windowlast + 1) % WINDOWSIZE; 
-    buffer[windowlast] = sendpkt;
-    windowcount++;
-
-    /* send out packet */
-    if (TRACE > 0)
-      printf("Sending packet %d to layer 3\n", sendpkt.seqnum);
-    tolayer3 (A, sendpkt);
-
-    /* start timer if first packet in window */
-    if (windowcount == 1)
-      starttimer(A,RTT);
-
-    /* get next sequence number, wrap back to 0 */
-    A_nextseqnum = (A_nextseqnum + 1) % SEQSPACE;  
+    /* create packet around the message, the payload is not copied */
+    A_send(s, a, msg_packet(message));
   }
-  /* if blocked,  window is full */
+  /* if blocked, queue the message if there is room */
+  else if (sendq_put(s, &a->sendq, message))
+    TRACE_VALUE(s, 1, TR_A_QUEUED, a->entity, sendq_count(&a->sendq));
+  /* window (and queue) is full */
   else {
-    if (TRACE > 0)
-      printf("----A: New message arrives, send window is full\n");
-    window_full++;
+    TRACE(s, 1, TR_A_WINDOWFULL, a->entity);
+    s->stats.window_full++;
   }
 }
 
 
-/* called from layer 3, when a packet arrives for layer 4 
-   In this practical this will always be an ACK as B never sends data.
-*/
-void A_input(struct pkt packet)
+/* an uncorrupted ACK from layer 3: on its own (pure), or carried by a
+   data packet in full duplex mode, which is no sign of a loss */
+static void A_ack(struct sim *s, struct sender *a, const struct pkt *packet, bool pure)
 {
   int ackcount = 0;
-  int i;
-
-  /* if received ACK is not corrupted */ 
-  if (!IsCorrupted(packet)) {
-    if (TRACE > 0)
-      printf("----A: uncorrupted ACK %d is received\n",packet.acknum);
-    total_ACKs_received++;
-
-    /* check if new ACK or duplicate */
-    if (windowcount != 0) {
-          int seqfirst = buffer[windowfirst].seqnum;
-          int seqlast = buffer[windowlast].seqnum;
-          /* check case when seqnum has and hasn't wrapped */
-          if (((seqfirst <= seqlast) && (packet.acknum >= seqfirst && packet.acknum <= seqlast)) ||
-              ((seqfirst > seqlast) && (packet.acknum >= seqfirst || packet.acknum <= seqlast))) {
-
-            /* packet is a new ACK */
-            if (TRACE > 0)
-              printf("----A: ACK %d is not a duplicate\n",packet.acknum);
-            new_ACKs++;
-
-            /* cumulative acknowledgement - determine how many packets are ACKed */
-            if (packet.acknum >= seqfirst)
-              ackcount = packet.acknum + 1 - seqfirst;
-            else
-              ackcount = SEQSPACE - seqfirst + packet.acknum;
-
-	    /* slide window by the number of packets ACKed */
-            windowfirst = (windowfirst + ackcount) % WINDOWSIZE;
-
-            /* delete the acked packets from window buffer */
-            for (i=0; i<ackcount; i++)
-              windowcount--;
-
-	    /* start timer again if there are still more unacked packets in window */
-            stoptimer(A);
-            if (windowcount > 0)
-              starttimer(A, RTT);
-
-          }
-        }
-        else
-          if (TRACE > 0)
-        printf ("----A: duplicate ACK received, do nothing!\n");
+  int i, slot = 0;
+
+  TRACE_PKT(s, 1, TR_A_ACK, a->entity, packet);
+  s->stats.total_ACKs_received++;
+
+  /* check if new ACK or duplicate */
+  if (a->windowcount != 0) {
+    int seqfirst = a->buffer[a->windowfirst]->seqnum;
+    int seqlast = a->buffer[a->windowlast]->seqnum;
+    /* check case when seqnum has and hasn't wrapped */
+    if (((seqfirst <= seqlast) && (packet->acknum >= seqfirst && packet->acknum <= seqlast)) ||
+        ((seqfirst > seqlast) && (packet->acknum >= seqfirst || packet->acknum <= seqlast))) {
+
+      /* packet is a new ACK */
+      TRACE_PKT(s, 1, TR_A_NEWACK, a->entity, packet);
+      s->stats.new_ACKs++;
+      a->dupcount = 0;
+      a->recovering = false;
+
+      /* cumulative acknowledgement - determine how many packets are ACKed */
+      if (packet->acknum >= seqfirst)
+        ackcount = packet->acknum + 1 - seqfirst;
+      else
+        ackcount = a->seqspace.n - seqfirst + packet->acknum;
+
+      /* delete the acked packets from window buffer, the ACK
+         is for the last of them, which gives the RTT sample */
+      for (i=0; i<ackcount; i++) {
+        slot = wrap(&a->window, a->windowfirst + i);
+        if (rto_spurious(&a->rto, &a->sends[slot], simtime(s)))
+          s->stats.spurious_resends++;
+        pkt_release(s, a->buffer[slot]);
+        a->windowcount--;
+      }
+      rto_sample(&a->rto, &a->sends[slot], simtime(s));
+      cc_ack(s, &a->cc, ackcount);
+
+      /* slide window by the number of packets ACKed */
+      a->windowfirst = wrap(&a->window, a->windowfirst + ackcount);
+
+      /* start timer again if there are still more unacked packets in window */
+      timers_stop(s, a->timers, TIMER_RETRANSMIT);
+      if (a->windowcount > 0)
+        timers_start(s, a->timers, TIMER_RETRANSMIT, rto_current(&a->rto));
+
+      /* the window has room for queued messages */
+      A_drain(s, a);
+    }
+    else if (pure && a->dupthresh > 0 && packet->acknum == wrap(&a->seqspace, seqfirst - 1 + a->seqspace.n))
+      A_dupack(s, a);
   }
-  else 
-    if (TRACE > 0)
-      printf ("----A: corrupted ACK is received, do nothing!\n");
+  else
+    TRACE(s, 1, TR_A_DUPACK, a->entity);
 }
 
-/* called when A's timer goes off */
-void A_timerinterrupt(void)
+/* called when the retransmission timer goes off */
+static void A_timeout(struct sim *s, struct sender *a)
 {
-  int i;
-
-  if (TRACE > 0)
-    printf("----A: time out,resend packets!\n");
-
-  for(i=0; i<windowcount; i++) {
-
-    if (TRACE > 0)
-      printf ("---A: resending packet %d\n", (buffer[(windowfirst+i) % WINDOWSIZE]).seqnum);
-
-    tolayer3(A,buffer[(windowfirst+i) % WINDOWSIZE]);
-    packets_resent++;
-    if (i==0) starttimer(A,RTT);
-  }
+  TRACE(s, 1, TR_A_TIMEOUT, a->entity);
+  rto_backoff(&a->rto);
+  cc_timeout(s, &a->cc);
+  a->dupcount = 0;
+  A_goback(s, a);
 }       
 
 
 
-/* the following routine will be called once (only) before any other */
-/* entity A routines are called. You can use it to do any initialization */
-void A_init(void)
+/* create the sending half of an entity, once before any other
+   sender routine is called */
+static struct sender *A_create(struct sim *s, struct entity *h)
 {
+  struct sender *a = simalloc(s, sizeof(struct sender));
+
+  a->entity = h->entity;
+  a->timers = &h->timers;
+  a->rcv = h->duplex ? h->rcv : NULL;
+  a->windowsize = s->cfg.windowsize;
+  modulus_init(&a->window, a->windowsize);
+  modulus_init(&a->seqspace, s->cfg.seqspace);
+  rto_init(&a->rto, s->cfg.rto, s->cfg.rtt);
+  cc_init(s, &a->cc, s->cfg.cc, a->windowsize);
+  sendq_init(s, &a->sendq);
+  a->dupthresh = s->cfg.dupacks;
+  a->buffer = simalloc(s, a->windowsize * sizeof(struct pkt *));
+  a->sends = simalloc(s, a->windowsize * sizeof(struct rtosend));
+
   /* initialise A's window, buffer and sequence number */
-  A_nextseqnum = 0;  /* A starts with seq num 0, do not change this */
-  windowfirst = 0;
-  windowlast = -1;   /* windowlast is where the last packet sent is stored.  
+  a->A_nextseqnum = 0;  /* A starts with seq num 0, do not change this */
+  a->windowfirst = 0;
+  a->windowlast = -1;   /* windowlast is where the last packet sent is stored.  
 		     new packets are placed in winlast + 1 
 		     so initially this is set to -1
 		   */
-  windowcount = 0;
+  a->windowcount = 0;
+  return a;
 }
 
 
 
 /********* Receiver (B)  variables and procedures ************/
 
-static int expectedseqnum; /* the sequence number expected next by the receiver */
-static int B_nextseqnum;   /* the sequence number for the next packets sent by B */
+/* receiver state, the receiving half of an entity */
+struct receiver {
+  int entity;         /* B, or A in full duplex mode */
+  struct timers *timers;
+  bool duplex;        /* pure ACKs have seqnum NOTINUSE */
+
+  int expectedseqnum; /* the sequence number expected next by the receiver */
+  int B_nextseqnum;   /* the sequence number for the next packets sent by B */
+  struct modulus seqspace;
+
+  /* delayed ACKs (--delack) */
+  int delack;         /* ACK every delack-th in-order packet */
+  double delacktime;  /* or this long after the first one not ACKed */
+  int unacked;        /* in-order packets received since the last ACK */
+  bool timing;        /* the ACK timer is running */
+};
+
+/* acknowledge everything up to acknum */
+static void B_sendack(struct sim *s, struct receiver *b, int acknum)
+{
+  struct pkt sendpkt;
+
+  if (b->timing)
+    timers_stop(s, b->timers, TIMER_ACK);
+  b->timing = false;
+  b->unacked = 0;
+
+  /* create packet */
+  sendpkt.acknum = acknum;
+  if (b->duplex)
+    sendpkt.seqnum = NOTINUSE;
+  else {
+    sendpkt.seqnum = b->B_nextseqnum;
+    b->B_nextseqnum = (b->B_nextseqnum + 1) % 2;
+  }
+    
+  /* we don't have any data to send, an ACK has no payload */
+  sendpkt.length = 0;
+
+  /* computer checksum */
+  sendpkt.checksum = ComputeChecksum(s, &sendpkt); 
 
+  /* send out packet */
+  s->stats.pure_acks[b->entity]++;
+  tolayer3 (s, b->entity, &sendpkt);
+}
 
-/* called from layer 3, when a packet arrives for layer 4 at B*/
-void B_input(struct pkt packet)
+/* the last packet received in order */
+static int B_lastinorder(const struct receiver *b)
 {
-  struct pkt sendpkt;
-  int i;
+  if (b->expectedseqnum == 0)
+    return b->seqspace.n - 1;
+  else
+    return b->expectedseqnum - 1;
+}
+
+/* the ACK for a data packet of the sending half to carry, which makes
+   an ACK held back unnecessary */
+static int B_piggyback(struct sim *s, struct receiver *b)
+{
+  if (b->unacked > 0) {
+    s->stats.piggybacked[b->entity]++;
+    if (b->timing)
+      timers_stop(s, b->timers, TIMER_ACK);
+    b->timing = false;
+    b->unacked = 0;
+  }
+  return B_lastinorder(b);
+}
 
+
+/* a data packet from layer 3, corrupted or not */
+static void B_receive(struct sim *s, struct receiver *b, const struct pkt *packet, bool corrupt)
+{
   /* if not corrupted and received packet is in order */
-  if  ( (!IsCorrupted(packet))  && (packet.seqnum == expectedseqnum) ) {
-    if (TRACE > 0)
-      printf("----B: packet %d is correctly received, send ACK!\n",packet.seqnum);
-    packets_received++;
+  if  ( (!corrupt)  && (packet->seqnum == b->expectedseqnum) ) {
+    TRACE_PKT(s, 1, TR_B_RECEIVED, b->entity, packet);
+    s->stats.packets_received++;
     /* deliver to receiving application */
-    tolayer5(B, packet.payload);
-
-    /* send an ACK for the received packet */
-    sendpkt.acknum = expectedseqnum;
+    tolayer5(s, b->entity, packet->payload, packet->length);
 
     /* update state variables */
-    expectedseqnum = (expectedseqnum + 1) % SEQSPACE;        
+    b->expectedseqnum = wrap(&b->seqspace, b->expectedseqnum + 1);        
+
+    /* with delayed ACKs, wait for more packets or for the timer */
+    if (++b->unacked < b->delack) {
+      if (!b->timing)
+        timers_start(s, b->timers, TIMER_ACK, b->delacktime);
+      b->timing = true;
+      return;
+    }
   }
-  else {
+  else
     /* packet is corrupted or out of order resend last ACK */
-    if (TRACE > 0) 
-      printf("----B: packet corrupted or not expected sequence number, resend ACK!\n");
-    if (expectedseqnum == 0)
-      sendpkt.acknum = SEQSPACE - 1;
-    else
-      sendpkt.acknum = expectedseqnum - 1;
-  }
+    TRACE(s, 1, TR_B_REJECTED, b->entity);
 
-  /* create packet */
-  sendpkt.seqnum = B_nextseqnum;
-  B_nextseqnum = (B_nextseqnum + 1) % 2;
-    
-  /* we don't have any data to send.  fill payload with 0's */
-  for ( i=0; i<20 ; i++ ) 
-    sendpkt.payload[i] = '0';  
+  /* send an ACK for the packets received so far */
+  B_sendack(s, b, B_lastinorder(b));
+}
 
-  /* computer checksum */
-  sendpkt.checksum = ComputeChecksum(sendpkt); 
+/* called when the ACK timer goes off: the delayed ACK is due */
+static void B_timeout(struct sim *s, struct receiver *b)
+{
+  b->timing = false;
+  if (b->unacked > 0)
+    B_sendack(s, b, B_lastinorder(b));
+}
 
-  /* send out packet */
-  tolayer3 (B, sendpkt);
+/* create the receiving half of an entity, once before any other
+   receiver routine is called */
+static struct receiver *B_create(struct sim *s, struct entity *h)
+{
+  struct receiver *b = simalloc(s, sizeof(struct receiver));
+
+  b->entity = h->entity;
+  b->timers = &h->timers;
+  b->duplex = h->duplex;
+  modulus_init(&b->seqspace, s->cfg.seqspace);
+  b->expectedseqnum = 0;
+  b->B_nextseqnum = 1;
+  b->delack = s->cfg.delack;
+  b->delacktime = s->cfg.delacktime;
+  /* in full duplex mode every ACK is held back for data to carry it */
+  if (b->duplex && b->delack <= 1)
+    b->delack = INT_MAX;
+  return b;
 }
 
+/********* Entities A and B ************/
+
 /* the following routine will be called once (only) before any other */
-/* entity B routines are called. You can use it to do any initialization */
-void B_init(void)
+/* routines of the entity are called */
+static void entity_init(struct sim *s, int AorB)
+{
+  struct entity *h = simalloc(s, sizeof(struct entity));
+
+  s->state[AorB] = h;
+  h->entity = AorB;
+  h->duplex = s->cfg.bidirectional;
+  timers_init(&h->timers, AorB);
+  if (AorB == B || h->duplex)
+    h->rcv = B_create(s, h);
+  if (AorB == A || h->duplex)
+    h->snd = A_create(s, h);
+}
+
+/* called from layer 3, when a packet arrives for layer 4: in simplex
+   mode ACKs for A and data for B, in full duplex mode data packets
+   carrying an ACK as well as pure ACKs */
+static void entity_input(struct sim *s, struct entity *h, const struct pkt *packet)
 {
-  expectedseqnum = 0;
-  B_nextseqnum = 1;
+  bool corrupt = IsCorrupted(s, packet);
+
+  if (!h->duplex) {
+    if (h->entity == B)
+      B_receive(s, h->rcv, packet, corrupt);
+    /* if received ACK is not corrupted */ 
+    else if (!corrupt)
+      A_ack(s, h->snd, packet, true);
+    else 
+      TRACE(s, 1, TR_A_CORRUPTACK, A);
+    return;
+  }
+  /* a corrupted packet may have been data, the receiver ACKs again */
+  if (!corrupt && packet->acknum != NOTINUSE)
+    A_ack(s, h->snd, packet, packet->seqnum == NOTINUSE);
+  if (corrupt || packet->seqnum != NOTINUSE)
+    B_receive(s, h->rcv, packet, corrupt);
 }
 
-/******************************************************************************
- * The following functions need be completed only for bi-directional messages *
- *****************************************************************************/
+/* called when the entity's timer goes off */
+static void entity_timerinterrupt(struct sim *s, struct entity *h)
+{
+  int expired = timers_expired(s, &h->timers);
+
+  if (expired & (1 << TIMER_RETRANSMIT))
+    A_timeout(s, h->snd);
+  if (expired & (1 << TIMER_ACK))
+    B_timeout(s, h->rcv);
+}
+
+static void A_init(struct sim *s)
+{
+  entity_init(s, A);
+}
+
+static void B_init(struct sim *s)
+{
+  entity_init(s, B);
+}
+
+/* called from layer 5 (application layer), passed the message to be
+   sent to other side; with simplex transfer from A to B there is no
+   B_output() */
+static void entity_output(struct sim *s, struct entity *h, const struct msg *message)
+{
+  if (h->snd != NULL)
+    A_message(s, h->snd, message);
+}
+
+static void A_output(struct sim *s, const struct msg *message)
+{
+  entity_output(s, s->state[A], message);
+}
+
+static void B_output(struct sim *s, const struct msg *message)  
+{
+  entity_output(s, s->state[B], message);
+}
+
+static void A_input(struct sim *s, const struct pkt *packet)
+{
+  entity_input(s, s->state[A], packet);
+}
+
+static void B_input(struct sim *s, const struct pkt *packet)
+{
+  entity_input(s, s->state[B], packet);
+}
 
-/* Note that with simplex transfer from a-to-B, there is no B_output() */
-void B_output(struct msg message)  
+static void A_timerinterrupt(struct sim *s)
 {
+  entity_timerinterrupt(s, s->state[A]);
 }
 
-/* called when B's timer goes off */
-void B_timerinterrupt(void)
+static void B_timerinterrupt(struct sim *s)
 {
+  entity_timerinterrupt(s, s->state[B]);
 }
 
+const struct protocol gbn_protocol = {
+  "gbn",
+  configure,
+  A_init, B_init,
+  A_output, B_output,
+  A_input, B_input,
+  A_timerinterrupt, B_timerinterrupt
+};
@@ -0,0 +1,122 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "hdr.h"
+
+/* ******************************************************************
+   HDR histogram, see hdr.h.
+
+   With S = 2^subbits sub-buckets, values below S have a bucket each.
+   A larger value v whose highest bit is bit k is shifted right by
+   k - subbits + 1, which leaves a sub-bucket number in [S/2, S), and
+   every shift adds another S/2 buckets after the linear ones.
+**********************************************************************/
+
+static int highbit(unsigned long long v)
+{
+  int k = 0;
+
+  while (v >>= 1)
+    k++;
+  return k;
+}
+
+static int bucketof(const struct hdr *h, unsigned long long v)
+{
+  int shift;
+
+  if (v < (1ULL << h->subbits))
+    return (int)v;
+  shift = highbit(v) - h->subbits + 1;
+  return shift * (1 << (h->subbits - 1)) + (int)(v >> shift);
+}
+
+/* largest value counted in bucket i */
+static unsigned long long bucketmax(const struct hdr *h, int i)
+{
+  int half = 1 << (h->subbits - 1);
+  int shift;
+
+  if (i < 2 * half)
+    return i;
+  shift = i / half - 1;
+  return ((unsigned long long)(i - shift * half + 1) << shift) - 1;
+}
+
+void hdr_init(struct hdr *h, double unit, double highest, int digits)
+{
+  double range = 2.0;
+  int i;
+
+  /* enough sub-buckets that one of them is below 10^-digits of its value */
+  for (i = 0; i < digits; i++)
+    range *= 10.0;
+  h->subbits = 1;
+  while ((double)(1 << h->subbits) < range)
+    h->subbits++;
+
+  h->unit = unit;
+  h->highest = highest;
+  h->nbuckets = bucketof(h, (unsigned long long)(highest / unit)) + 1;
+  h->counts = calloc(h->nbuckets, sizeof(long));
+  if (h->counts == NULL) {
+    printf("memory allocation for histogram failed.");
+    exit(EXIT_FAILURE);
+  }
+  h->total = 0;
+  h->sum = h->min = h->max = 0.0;
+}
+
+void hdr_free(struct hdr *h)
+{
+  free(h->counts);
+  h->counts = NULL;
+}
+
+void hdr_record(struct hdr *h, double value)
+{
+  int i;
+
+  if (value < 0.0)
+    value = 0.0;
+  i = value < h->highest ? bucketof(h, (unsigned long long)(value / h->unit)) : h->nbuckets - 1;
+  h->counts[i]++;
+  if (h->total == 0 || value < h->min)
+    h->min = value;
+  if (h->total == 0 || value > h->max)
+    h->max = value;
+  h->total++;
+  h->sum += value;
+}
+
+double hdr_percentile(const struct hdr *h, double p)
+{
+  double v;
+  long rank, seen = 0;
+  int i;
+
+  if (h->total == 0)
+    return 0.0;
+  v = p / 100.0 * h->total;
+  rank = (long)v;
+  if (rank < v)
+    rank++;
+  if (rank < 1)
+    rank = 1;
+  for (i = 0; i < h->nbuckets; i++) {
+    seen += h->counts[i];
+    if (seen >= rank)
+      break;
+  }
+  /* report the top of the bucket, but never beyond what was seen */
+  v = (bucketmax(h, i) + 1) * h->unit;
+  if (v > h->max)
+    v = h->max;
+  if (v < h->min)
+    v = h->min;
+  return v;
+}
+
+double hdr_mean(const struct hdr *h)
+{
+  return h->total > 0 ? h->sum / h->total : 0.0;
+}
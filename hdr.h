@@ -0,0 +1,37 @@
+#ifndef HDR_H
+#define HDR_H
+
+/* ******************************************************************
+   High dynamic range histogram.
+
+   Values are counted in units of "unit" in log-linear buckets: every
+   power of two is split into the same number of linear sub-buckets,
+   enough to keep the given number of significant decimal digits.  The
+   relative error of a percentile is therefore bounded over the whole
+   range from unit to highest, with a few thousand counters.  Values
+   above highest are counted in the top bucket; the exact minimum,
+   maximum and mean are kept separately.
+**********************************************************************/
+
+struct hdr {
+  double unit;             /* value of one count step */
+  double highest;          /* largest value with bounded error */
+  int subbits;             /* log2 of the sub-buckets per power of two */
+  int nbuckets;
+  long *counts;
+
+  long total;              /* values recorded */
+  double sum, min, max;
+};
+
+extern void hdr_init(struct hdr *, double unit, double highest, int digits);
+extern void hdr_free(struct hdr *);
+
+extern void hdr_record(struct hdr *, double value);
+
+/* the value below which p percent of the recorded values fall (0 if
+   nothing was recorded), and the exact mean */
+extern double hdr_percentile(const struct hdr *, double p);
+extern double hdr_mean(const struct hdr *);
+
+#endif
@@ -0,0 +1,142 @@
+#include <math.h>
+#include "emulator.h"
+#include "link.h"
+
+/* ******************************************************************
+   Bandwidth and router queue of the medium, see link.h.
+
+   The link sends packets in the order they are queued, so the time
+   each one is put on the wire is known when it is queued, and the
+   queue is just the list of those times that are still to come.
+   CoDel decides at the head of the queue; that is when a packet
+   starts to be sent, also known when it is queued, so the decision is
+   made then, in the same order.  A packet it drops does not take up
+   the link, the next one starts when it would have.  (RFC 8289 also
+   keeps dropping off when less than an MTU is queued behind the
+   packet; that depends on packets yet to come and is left out.)
+**********************************************************************/
+
+#define RED_WEIGHT 0.002   /* of each new queue length in the average */
+#define RED_MAXP   0.1     /* drop probability at the max threshold */
+
+static void link_grow(struct sim *s, struct link *l)
+{
+  int size = l->size > 0 ? 2 * l->size : 16;
+  double *done = simalloc(s, size * sizeof(double));
+  int i;
+
+  for (i = 0; i < l->count; i++)
+    done[i] = l->done[(l->first + i) % l->size];
+  l->done = done;
+  l->first = 0;
+  l->size = size;
+}
+
+void link_init(struct sim *s, struct link *l)
+{
+  l->busy = 0.0;
+  l->first = l->count = 0;
+  l->size = 0;
+  if (s->cfg.bandwidth > 0.0) {
+    l->size = s->cfg.linkqueue;
+    if (l->size > 0)
+      l->done = simalloc(s, l->size * sizeof(double));
+  }
+  l->avg = 0.0;
+  l->since = -1;
+  l->above = l->dropnext = 0.0;
+  l->dropping = 0;
+  l->drops = l->lastdrops = 0;
+}
+
+/* RED: an early drop of a packet that takes tx to send */
+static int red_drop(struct sim *s, struct link *l, int AorB, double tx)
+{
+  double minth = fmax(s->cfg.linkqueue / 4.0, 1.0);
+  double maxth = fmax(3.0 * s->cfg.linkqueue / 4.0, minth + 1.0);
+  double pb, pa;
+
+  /* an idle queue forgets as if empty packets had gone through */
+  if (l->count == 0)
+    l->avg *= pow(1.0 - RED_WEIGHT, (simtime(s) - l->busy) / tx);
+  l->avg = (1.0 - RED_WEIGHT) * l->avg + RED_WEIGHT * l->count;
+
+  if (l->avg < minth) {
+    l->since = -1;
+    return 0;
+  }
+  if (l->avg < maxth) {
+    l->since++;
+    pb = RED_MAXP * (l->avg - minth) / (maxth - minth);
+    pa = l->since * pb < 1.0 ? pb / (1.0 - l->since * pb) : 1.0;
+    if (packetrand(s, RNG_LOSS, AorB, 1) >= pa)
+      return 0;
+  }
+  l->since = 0;
+  return 1;
+}
+
+/* CoDel: a drop at the head of the queue at time start, after waiting */
+static int codel_drop(struct sim *s, struct link *l, double start, double waited)
+{
+  double interval = s->cfg.rtt;
+  double target = interval / 20.0;
+  int ok = 0;
+
+  if (waited < target)
+    l->above = 0.0;
+  else if (l->above == 0.0)
+    l->above = start + interval;
+  else if (start >= l->above)
+    ok = 1;
+
+  if (l->dropping) {
+    if (!ok) {
+      l->dropping = 0;
+      return 0;
+    }
+    if (start < l->dropnext)
+      return 0;
+    l->drops++;
+    l->dropnext += interval / sqrt(l->drops);
+    return 1;
+  }
+  if (!ok)
+    return 0;
+  /* start again near the drop rate that was enough last time */
+  l->dropping = 1;
+  if (l->drops - l->lastdrops > 1 && start - l->dropnext < 16.0 * interval)
+    l->drops -= l->lastdrops;
+  else
+    l->drops = 1;
+  l->lastdrops = l->drops;
+  l->dropnext = start + interval / sqrt(l->drops);
+  return 1;
+}
+
+double link_send(struct sim *s, struct link *l, int AorB, int length)
+{
+  double tx = (LINK_HEADER + length) / s->cfg.bandwidth;
+  double start;
+
+  /* forget the packets that are on the wire by now */
+  while (l->count > 0 && l->done[l->first] <= simtime(s)) {
+    l->first = (l->first + 1) % l->size;
+    l->count--;
+  }
+  if (s->cfg.linkqueue > 0 && l->count >= s->cfg.linkqueue)
+    return -1.0;
+  start = fmax(simtime(s), l->busy);
+  if (s->cfg.linkpolicy == LINK_RED && red_drop(s, l, AorB, tx))
+    return -1.0;
+  if (s->cfg.linkpolicy == LINK_CODEL && codel_drop(s, l, start, start - simtime(s)))
+    return -1.0;
+
+  if (l->count == l->size)
+    link_grow(s, l);
+  l->busy = start + tx;
+  l->done[(l->first + l->count++) % l->size] = l->busy;
+  if (l->count > s->stats.link_queue_max)
+    s->stats.link_queue_max = l->count;
+  return l->busy;
+}
@@ -0,0 +1,55 @@
+#ifndef LINK_H
+#define LINK_H
+
+/* ******************************************************************
+   Bandwidth and router queue of the medium towards an entity.
+
+   Without a bandwidth (--bandwidth 0, the default) a packet reaches
+   the other side --delay plus a random --jitter after the packet in
+   flight before it, however many are in flight, as the emulator has
+   always done.
+
+   With --bandwidth R (bytes per time unit) the sender's side of the
+   medium is a link that sends one packet at a time: a packet takes
+   (LINK_HEADER + length) / R to put on the wire, after the packets
+   queued before it, and arrives --delay plus --jitter after that
+   (never before the packet ahead of it).  The queue holds at most
+   --link-queue packets, including the one being sent (0 for no
+   limit), and --link-policy decides which packets it drops:
+   - droptail: only those that find it full;
+   - red: Random Early Detection (Floyd and Jacobson), early drops with
+   a probability that grows with the average queue length between a
+   quarter and three quarters of the limit;
+   - codel: Controlled Delay (RFC 8289), drops at the head while
+   packets have been waiting longer than a target of rtt / 20 for a
+   whole interval of rtt, more often the longer that lasts.
+   Queue drops are counted in link_drops, apart from random losses.
+**********************************************************************/
+
+struct sim;
+
+#define LINK_HEADER 16     /* bytes of seqnum, acknum, checksum and length */
+
+struct link {
+  double busy;             /* when the packets queued have all been sent */
+  double *done;            /* when each queued packet is sent, oldest first */
+  int first, count, size;
+
+  /* RED */
+  double avg;              /* average queue length */
+  int since;               /* packets queued since the last drop, -1 below min */
+
+  /* CoDel */
+  double above;            /* when waiting above target has lasted an interval, 0 if not */
+  double dropnext;         /* when to drop next while dropping */
+  int dropping;
+  int drops, lastdrops;    /* drops in this and the last dropping state */
+};
+
+extern void link_init(struct sim *, struct link *);
+
+/* queue a packet of length payload bytes sent by AorB, returns when it
+   has been put on the wire, or -1 if the queue drops it */
+extern double link_send(struct sim *, struct link *, int AorB, int length);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef MODULUS_H
+#define MODULUS_H
+
+/* ******************************************************************
+   Wrapping of sequence numbers and buffer indexes.  The size of the
+   sequence space and of the window are run time parameters; when one
+   is a power of two, its wraps are a mask instead of a division.
+**********************************************************************/
+
+struct modulus {
+  int n;
+  int mask;                /* n - 1 */
+  int pow2;                /* n is a power of two */
+};
+
+static inline void modulus_init(struct modulus *m, int n)
+{
+  m->n = n;
+  m->mask = n - 1;
+  m->pow2 = n > 0 && (n & (n - 1)) == 0;
+}
+
+/* x mod n, for x >= 0 */
+static inline int wrap(const struct modulus *m, int x)
+{
+  return m->pow2 ? x & m->mask : x % m->n;
+}
+
+#endif
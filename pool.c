@@ -0,0 +1,157 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "pool.h"
+
+/* ******************************************************************
+   Slab/free-list allocator, see pool.h.
+**********************************************************************/
+
+#define POISON 0xDB    /* byte written over freed slots in debug mode */
+
+struct slab {
+  struct slab *next;
+  /* slots follow, aligned like align_t */
+};
+
+/* alignment required for any object stored in a pool */
+typedef union {
+  void *p;
+  long l;
+  double d;
+} align_t;
+
+#define SLAB_HEADER (((sizeof(struct slab) + sizeof(align_t) - 1) / sizeof(align_t)) * sizeof(align_t))
+
+void pool_init(struct pool *pool, size_t objsize, int perslab, int debug)
+{
+  if (objsize < sizeof(void *))
+    objsize = sizeof(void *);
+  pool->objsize = ((objsize + sizeof(align_t) - 1) / sizeof(align_t)) * sizeof(align_t);
+  pool->perslab = perslab > 0 ? perslab : 1;
+  pool->debug = debug;
+  pool->freelist = NULL;
+  pool->slabs = NULL;
+  pool->current = 0;
+  pool->peak = 0;
+  pool->allocs = 0;
+  pool->capacity = 0;
+}
+
+void pool_destroy(struct pool *pool)
+{
+  struct slab *slab, *next;
+
+  for (slab = pool->slabs; slab != NULL; slab = next) {
+    next = slab->next;
+    free(slab);
+  }
+  pool->slabs = NULL;
+  pool->freelist = NULL;
+  pool->capacity = 0;
+}
+
+/* the first word of a free slot links it to the next free slot, the
+   rest of the slot holds the poison pattern in debug mode */
+static void poison(struct pool *pool, void *obj)
+{
+  memset((char *)obj + sizeof(void *), POISON, pool->objsize - sizeof(void *));
+}
+
+/* true if obj is the start of a slot of one of the pool's slabs */
+static int owned(struct pool *pool, const void *obj)
+{
+  const struct slab *slab;
+  const char *first;
+
+  for (slab = pool->slabs; slab != NULL; slab = slab->next) {
+    first = (const char *)slab + SLAB_HEADER;
+    if ((const char *)obj >= first && (const char *)obj < first + pool->perslab * pool->objsize)
+      return ((const char *)obj - first) % pool->objsize == 0;
+  }
+  return 0;
+}
+
+/* true if the slot holds the poison pattern and its link is another
+   free slot or the end of the list */
+static int poisoned(struct pool *pool, void *obj)
+{
+  const unsigned char *p = (const unsigned char *)obj + sizeof(void *);
+  void *link = *(void **)obj;
+  size_t i;
+
+  for (i = 0; i < pool->objsize - sizeof(void *); i++)
+    if (p[i] != POISON)
+      return 0;
+  return link == NULL || owned(pool, link);
+}
+
+static int onfreelist(struct pool *pool, void *obj)
+{
+  void *p;
+
+  for (p = pool->freelist; p != NULL; p = *(void **)p)
+    if (p == obj)
+      return 1;
+  return 0;
+}
+
+static void pool_grow(struct pool *pool)
+{
+  struct slab *slab;
+  char *obj;
+  int i;
+
+  slab = malloc(SLAB_HEADER + pool->perslab * pool->objsize);
+  if (slab == NULL) {
+    printf("memory allocation for pool failed.");
+    exit(EXIT_FAILURE);
+  }
+  slab->next = pool->slabs;
+  pool->slabs = slab;
+  pool->capacity += pool->perslab;
+
+  /* thread the new slots onto the free list, first slot on top */
+  obj = (char *)slab + SLAB_HEADER;
+  for (i = pool->perslab - 1; i >= 0; i--) {
+    if (pool->debug)
+      poison(pool, obj + i * pool->objsize);
+    *(void **)(obj + i * pool->objsize) = pool->freelist;
+    pool->freelist = obj + i * pool->objsize;
+  }
+}
+
+void *pool_alloc(struct pool *pool)
+{
+  void *obj;
+
+  if (pool->freelist == NULL)
+    pool_grow(pool);
+  obj = pool->freelist;
+  if (pool->debug && !poisoned(pool, obj)) {
+    printf("POOL PANIC: object at %p was modified after it was freed\n", obj);
+    abort();
+  }
+  pool->freelist = *(void **)obj;
+
+  pool->allocs++;
+  if (++pool->current > pool->peak)
+    pool->peak = pool->current;
+  return obj;
+}
+
+void pool_free(struct pool *pool, void *obj)
+{
+  if (obj == NULL)
+    return;
+  if (pool->debug) {
+    if (poisoned(pool, obj) && onfreelist(pool, obj)) {
+      printf("POOL PANIC: object at %p was freed twice\n", obj);
+      abort();
+    }
+    poison(pool, obj);
+  }
+  *(void **)obj = pool->freelist;
+  pool->freelist = obj;
+  pool->current--;
+}
@@ -0,0 +1,40 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+/* ******************************************************************
+   Fixed-size object pool.
+
+   Objects are carved out of slabs allocated with malloc and recycled
+   through a free list, so steady-state allocation never reaches the
+   system allocator.  Slabs are only returned by pool_destroy().
+
+   In debug mode every freed slot is filled with a poison pattern that
+   is checked again when the slot is handed out, along with its link to
+   the next free slot; a mismatch means the object was written after it
+   was freed.  Freeing a slot that is already on the free list aborts.
+**********************************************************************/
+
+struct slab;
+
+struct pool {
+  size_t objsize;        /* slot size, rounded up for alignment */
+  int perslab;           /* slots carved from each slab */
+  int debug;             /* poison freed slots and check them */
+  void *freelist;
+  struct slab *slabs;
+
+  long current;          /* slots in use */
+  long peak;             /* largest value current has reached */
+  long allocs;           /* total number of pool_alloc() calls */
+  long capacity;         /* slots owned by the pool */
+};
+
+extern void pool_init(struct pool *, size_t objsize, int perslab, int debug);
+extern void pool_destroy(struct pool *);
+
+extern void *pool_alloc(struct pool *);
+extern void pool_free(struct pool *, void *);
+
+#endif
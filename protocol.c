@@ -0,0 +1,29 @@
+#include <string.h>
+#include "protocol.h"
+#include "gbn.h"
+#include "sr.h"
+
+/* ******************************************************************
+   The protocols linked into the simulator, see protocol.h.
+**********************************************************************/
+
+static const struct protocol *protocols[] = {
+  &gbn_protocol,               /* the default */
+  &sr_protocol,
+  NULL
+};
+
+const struct protocol *protocol_find(const char *name)
+{
+  int i;
+
+  for (i = 0; protocols[i] != NULL; i++)
+    if (strcmp(protocols[i]->name, name) == 0)
+      return protocols[i];
+  return NULL;
+}
+
+const struct protocol *protocol_default(void)
+{
+  return protocols[0];
+}
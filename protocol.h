@@ -0,0 +1,39 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include "emulator.h"
+
+/* ******************************************************************
+   Transport protocols.
+
+   A protocol is the set of routines the emulator calls for the two
+   entities.  Each implementation keeps its routines private and
+   exports one struct protocol, listed in protocol.c, so any number of
+   protocols are linked into the same simulator and chosen per run
+   with --protocol.
+**********************************************************************/
+
+struct protocol {
+  const char *name;
+
+  /* fill in the protocol's defaults for window, seqspace and rtt and
+     check them against its rules, returns 0 if they are usable */
+  int (*configure)(struct simconfig *);
+
+  void (*A_init)(struct sim *);
+  void (*B_init)(struct sim *);
+  void (*A_output)(struct sim *, const struct msg *);
+  void (*B_output)(struct sim *, const struct msg *);
+  void (*A_input)(struct sim *, const struct pkt *);
+  void (*B_input)(struct sim *, const struct pkt *);
+  void (*A_timerinterrupt)(struct sim *);
+  void (*B_timerinterrupt)(struct sim *);
+};
+
+/* the protocol with the given name, NULL if there is none */
+extern const struct protocol *protocol_find(const char *name);
+
+/* the protocol used when none is chosen */
+extern const struct protocol *protocol_default(void);
+
+#endif
@@ -0,0 +1,103 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "report.h"
+
+/* ******************************************************************
+   JSON/CSV summary writer, see report.h.
+**********************************************************************/
+
+void report_init(struct report *r)
+{
+  r->nitems = 0;
+}
+
+static struct report_item *additem(struct report *r, const char *name, int kind)
+{
+  struct report_item *item;
+
+  if (r->nitems == REPORT_MAXITEMS) {
+    printf("INTERNAL PANIC: too many report items\n");
+    exit(EXIT_FAILURE);
+  }
+  item = &r->items[r->nitems++];
+  item->name = name;
+  item->kind = kind;
+  return item;
+}
+
+void report_int(struct report *r, const char *name, long value)
+{
+  additem(r, name, 'i')->ival = value;
+}
+
+void report_real(struct report *r, const char *name, double value)
+{
+  additem(r, name, 'f')->fval = value;
+}
+
+void report_string(struct report *r, const char *name, const char *value)
+{
+  additem(r, name, 's')->sval = value;
+}
+
+static void writevalue(const struct report_item *item, FILE *f, int quote)
+{
+  switch (item->kind) {
+  case 'i':
+    fprintf(f, "%ld", item->ival);
+    break;
+  case 'f':
+    fprintf(f, "%.8g", item->fval);
+    break;
+  default:
+    if (quote)
+      fprintf(f, "\"%s\"", item->sval);
+    else
+      fprintf(f, "%s", item->sval);
+  }
+}
+
+void report_write(const struct report *r, FILE *f, int format, int header)
+{
+  int i;
+
+  if (format == REPORT_CSV) {
+    if (header) {
+      for (i = 0; i < r->nitems; i++)
+        fprintf(f, "%s%s", i ? "," : "", r->items[i].name);
+      fprintf(f, "\n");
+    }
+    for (i = 0; i < r->nitems; i++) {
+      if (i)
+        fprintf(f, ",");
+      writevalue(&r->items[i], f, 0);
+    }
+    fprintf(f, "\n");
+  }
+  else {
+    fprintf(f, "{");
+    for (i = 0; i < r->nitems; i++) {
+      fprintf(f, "%s\"%s\": ", i ? ", " : "", r->items[i].name);
+      writevalue(&r->items[i], f, 1);
+    }
+    fprintf(f, "}\n");
+  }
+}
+
+int report_save(const struct report *r, const char *path, int format)
+{
+  FILE *f;
+
+  if (path[0] == '-' && path[1] == '\0') {
+    report_write(r, stdout, format, 1);
+    return 0;
+  }
+  if ((f = fopen(path, "a")) == NULL) {
+    printf("cannot open report file %s\n", path);
+    return -1;
+  }
+  fseek(f, 0, SEEK_END);
+  report_write(r, f, format, ftell(f) == 0);
+  fclose(f);
+  return 0;
+}
@@ -0,0 +1,46 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <stdio.h>
+
+/* ******************************************************************
+   Machine readable end-of-run summary.
+
+   A report is an ordered list of named values.  It is written either
+   as one JSON object per line or as one CSV row, with a header row
+   when the CSV file is empty, so many runs can be appended to the same
+   file and loaded without parsing the human readable output.
+**********************************************************************/
+
+/* report formats */
+#define REPORT_JSON 0
+#define REPORT_CSV  1
+
+#define REPORT_MAXITEMS 128
+
+struct report_item {
+  const char *name;
+  int kind;                /* 'i' integer, 'f' real, 's' string */
+  long ival;
+  double fval;
+  const char *sval;
+};
+
+struct report {
+  int nitems;
+  struct report_item items[REPORT_MAXITEMS];
+};
+
+extern void report_init(struct report *);
+extern void report_int(struct report *, const char *name, long value);
+extern void report_real(struct report *, const char *name, double value);
+extern void report_string(struct report *, const char *name, const char *value);
+
+/* append the report to a stream in REPORT_JSON or REPORT_CSV format;
+   header selects whether a CSV header row is written first */
+extern void report_write(const struct report *, FILE *, int format, int header);
+
+/* append the report to a file ("-" for stdout), returns 0 on success */
+extern int report_save(const struct report *, const char *path, int format);
+
+#endif
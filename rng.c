@@ -0,0 +1,169 @@
+#include <string.h>
+#include "rng.h"
+
+/* ******************************************************************
+   See rng.h.
+**********************************************************************/
+
+#define COMPAT_DEG 31
+#define COMPAT_SEP 3
+#define COMPAT_MAX 2147483647.0   /* RAND_MAX of glibc */
+
+int rng_kind(const char *name)
+{
+  if (strcmp(name, "xoshiro") == 0)
+    return RNG_XOSHIRO;
+  if (strcmp(name, "compat") == 0)
+    return RNG_COMPAT;
+  return -1;
+}
+
+const char *rng_name(int kind)
+{
+  return kind == RNG_COMPAT ? "compat" : "xoshiro";
+}
+
+/********************* glibc compatible ***********************/
+
+static int32_t compat_next(struct rng *g)
+{
+  uint32_t val;
+
+  val = g->r[g->front] += g->r[g->rear];
+  if (++g->front >= COMPAT_DEG) {
+    g->front = 0;
+    ++g->rear;
+  }
+  else if (++g->rear >= COMPAT_DEG)
+    g->rear = 0;
+  return (int32_t)(val >> 1);
+}
+
+/* as glibc's srandom_r(): fill the state with the Park-Miller "minimal
+   standard" generator and discard the first 310 outputs */
+static void compat_seed(struct rng *g, unsigned int seed)
+{
+  int32_t word, hi, lo;
+  int i;
+
+  if (seed == 0)
+    seed = 1;
+  g->r[0] = seed;
+  word = (int32_t)seed;
+  for (i = 1; i < COMPAT_DEG; i++) {
+    /* word = 16807 * word % 2147483647, without overflow (Schrage) */
+    hi = word / 127773;
+    lo = word % 127773;
+    word = 16807 * lo - 2836 * hi;
+    if (word < 0)
+      word += 2147483647;
+    g->r[i] = (uint32_t)word;
+  }
+  g->front = COMPAT_SEP;
+  g->rear = 0;
+  for (i = 0; i < 10 * COMPAT_DEG; i++)
+    (void)compat_next(g);
+}
+
+/********************* xoshiro256** ***********************/
+
+static uint64_t rotl(uint64_t x, int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+static uint64_t xoshiro_next(uint64_t *s)
+{
+  uint64_t result = rotl(s[1] * 5, 7) * 9;
+  uint64_t t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 45);
+  return result;
+}
+
+/* advance s by the number of draws encoded in the jump polynomial */
+static void xoshiro_jump(uint64_t *s, const uint64_t *poly)
+{
+  uint64_t t[4] = { 0, 0, 0, 0 };
+  int i, b;
+
+  for (i = 0; i < 4; i++)
+    for (b = 0; b < 64; b++) {
+      if (poly[i] & ((uint64_t)1 << b)) {
+        t[0] ^= s[0];
+        t[1] ^= s[1];
+        t[2] ^= s[2];
+        t[3] ^= s[3];
+      }
+      xoshiro_next(s);
+    }
+  memcpy(s, t, sizeof(t));
+}
+
+static const uint64_t JUMP[4] = {         /* 2^128 draws */
+  0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+  0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+};
+static const uint64_t LONG_JUMP[4] = {    /* 2^192 draws */
+  0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL,
+  0x77710069854ee241ULL, 0x39109bb02acbe635ULL
+};
+
+#define GOLDEN 0x9e3779b97f4a7c15ULL
+
+/* the splitmix64 output function, a bijective 64 bit mixer */
+static uint64_t mix64(uint64_t z)
+{
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+static uint64_t splitmix64(uint64_t *x)
+{
+  return mix64(*x += GOLDEN);
+}
+
+/********************* interface ***********************/
+
+void rng_seed(struct rng *g, int kind, uint64_t seed, unsigned long replication)
+{
+  uint64_t x = seed;
+  unsigned long r;
+  int i;
+
+  g->kind = kind;
+  g->key = mix64(mix64(seed + GOLDEN) ^ (replication + 1) * GOLDEN);
+  if (kind == RNG_COMPAT) {
+    compat_seed(g, (unsigned int)seed);
+    return;
+  }
+  for (i = 0; i < 4; i++)
+    g->s[0][i] = splitmix64(&x);
+  for (r = 0; r < replication; r++)
+    xoshiro_jump(g->s[0], LONG_JUMP);
+  for (i = 1; i < RNG_STREAMS; i++) {
+    memcpy(g->s[i], g->s[i - 1], sizeof(g->s[i]));
+    xoshiro_jump(g->s[i], JUMP);
+  }
+}
+
+double rng_keyed(const struct rng *g, int stream, int entity, unsigned long index, int draw)
+{
+  uint64_t counter = (((uint64_t)index * RNG_STREAMS + stream) * 4 + draw) * 2 + entity;
+
+  return (mix64(g->key ^ mix64(counter * GOLDEN)) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double rng_uniform(struct rng *g, int stream)
+{
+  if (g->kind == RNG_COMPAT)
+    return compat_next(g) / COMPAT_MAX;
+  /* the top 53 bits give every double in [0,1) with equal spacing */
+  return (xoshiro_next(g->s[stream]) >> 11) * (1.0 / 9007199254740992.0);
+}
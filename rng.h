@@ -0,0 +1,67 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/* ******************************************************************
+   Per-simulation random number generator.
+
+   RNG_XOSHIRO (the default) is xoshiro256** (Blackman and Vigna).  A
+   master seed is expanded with splitmix64, every replication is moved
+   2^192 draws along the sequence (long jump) and every purpose of
+   random numbers gets its own stream 2^128 draws further on (jump), so
+   arrivals, losses, corruption and delays are independent of each
+   other and reproducible from (seed, replication) alone.
+
+   RNG_COMPAT is a reentrant re-implementation of the additive feedback
+   generator behind glibc's rand()/random() (the default TYPE_3 state of
+   31 words).  All purposes share the one stream, so a run draws exactly
+   the numbers that srand(seed); rand() gave on Linux; use it to compare
+   against results of the original emulator.
+
+   Keyed draws do not depend on how many numbers were drawn before:
+   rng_keyed() hashes (seed, replication, stream, entity, index, draw)
+   into a uniform number, so two runs with different protocols can give
+   the n-th packet sent by an entity the same fate (common random
+   numbers).
+**********************************************************************/
+
+#define RNG_XOSHIRO 0
+#define RNG_COMPAT  1
+
+/* purposes of random numbers, each has its own stream */
+#define RNG_ARRIVAL  0   /* layer 5 inter-arrival times, sending entity */
+#define RNG_LOSS     1   /* packet loss */
+#define RNG_CORRUPT  2   /* packet corruption and what gets corrupted */
+#define RNG_DELAY    3   /* channel delay */
+#define RNG_STREAMS  4
+
+struct rng {
+  int kind;                       /* RNG_XOSHIRO or RNG_COMPAT */
+
+  /* RNG_XOSHIRO */
+  uint64_t s[RNG_STREAMS][4];
+
+  /* keyed draws, either kind */
+  uint64_t key;
+
+  /* RNG_COMPAT */
+  uint32_t r[31];
+  int front;                      /* the "fptr" of glibc's random_r */
+  int rear;                       /* the "rptr" of glibc's random_r */
+};
+
+/* parse a generator name ("xoshiro", "compat"), -1 if unknown */
+extern int rng_kind(const char *name);
+extern const char *rng_name(int kind);
+
+extern void rng_seed(struct rng *, int kind, uint64_t seed, unsigned long replication);
+
+/* uniform double in [0,1] from the stream for a purpose */
+extern double rng_uniform(struct rng *, int stream);
+
+/* uniform double in [0,1) for draw number draw (0-3) of a purpose
+   for the index-th event of an entity */
+extern double rng_keyed(const struct rng *, int stream, int entity, unsigned long index, int draw);
+
+#endif
@@ -0,0 +1,69 @@
+#include <math.h>
+#include "config.h"
+#include "rto.h"
+
+/* ******************************************************************
+   Retransmission timeouts, see rto.h.
+**********************************************************************/
+
+/* gains of RFC 6298 */
+#define ALPHA 0.125
+#define BETA  0.25
+
+void rto_init(struct rto *r, int kind, double initial)
+{
+  r->adaptive = (kind == RTO_ADAPTIVE);
+  r->rto = initial;
+  r->srtt = r->rttvar = 0.0;
+  r->minrtt = 0.0;
+  r->backoffs = 0;
+}
+
+void rto_backoff(struct rto *r)
+{
+  if (!r->adaptive || r->backoffs == RTO_BACKOFFS)
+    return;
+  r->backoffs++;
+  r->rto = fmin(2.0 * r->rto, RTO_MAX);
+}
+
+void rto_sent(struct rtosend *p, double now)
+{
+  p->sent = now;
+  p->resent = now;
+  p->retransmitted = false;
+}
+
+void rto_resent(struct rtosend *p, double now)
+{
+  p->resent = now;
+  p->retransmitted = true;
+}
+
+void rto_sample(struct rto *r, const struct rtosend *p, double now)
+{
+  double rtt;
+
+  if (p->retransmitted)          /* Karn: whose ACK is it? */
+    return;
+  rtt = now - p->sent;
+  if (r->minrtt == 0.0 || rtt < r->minrtt)
+    r->minrtt = rtt;
+  if (!r->adaptive)
+    return;
+  if (r->srtt == 0.0) {
+    r->srtt = rtt;
+    r->rttvar = rtt / 2.0;
+  }
+  else {
+    r->rttvar = (1.0 - BETA) * r->rttvar + BETA * fabs(r->srtt - rtt);
+    r->srtt = (1.0 - ALPHA) * r->srtt + ALPHA * rtt;
+  }
+  r->rto = fmin(fmax(r->srtt + 4.0 * r->rttvar, RTO_MIN), RTO_MAX);
+  r->backoffs = 0;
+}
+
+bool rto_spurious(const struct rto *r, const struct rtosend *p, double now)
+{
+  return p->retransmitted && r->minrtt > 0.0 && now - p->resent < r->minrtt;
+}
@@ -0,0 +1,71 @@
+#ifndef RTO_H
+#define RTO_H
+
+#include <stdbool.h>
+
+/* ******************************************************************
+   Retransmission timeouts.
+
+   With --rto fixed (the default) the timeout is always the --rtt
+   parameter.  With --rto adaptive it follows Jacobson and Karels as in
+   RFC 6298: round trip samples are smoothed into SRTT and RTTVAR, the
+   timeout is SRTT + 4 * RTTVAR, and every expiry doubles it until the
+   next sample, at most RTO_BACKOFFS times.  By Karn's rule only
+   packets that were sent once give samples, as the ACK of a resent
+   packet may belong to any copy.  When losses and corruption are
+   frequent a whole window can be resent before one of them is ACKed;
+   without the cap the timeout then doubled up to RTO_MAX and the
+   sender all but stopped.  Even so an adaptive timeout delivers less
+   than the fixed one under heavy loss: the samples include the time
+   packets wait behind the window, so SRTT and RTTVAR are large, and
+   SR recovers one loss per timeout.
+
+   In both modes a resend is counted as spurious when its packet is
+   acknowledged sooner after the resend than the shortest round trip
+   seen so far: that ACK can only have come from an earlier copy, so
+   waiting a little longer would have saved the resend.
+**********************************************************************/
+
+#define RTO_MIN 1.0            /* bounds of an adaptive timeout, in time units */
+#define RTO_MAX 10000.0
+#define RTO_BACKOFFS 2         /* doublings of the timeout without a sample */
+
+struct rto {
+  int adaptive;            /* RTO_ADAPTIVE rather than RTO_FIXED, see config.h */
+  double rto;              /* the current timeout */
+  double srtt, rttvar;     /* smoothed round trip and its variation */
+  double minrtt;           /* shortest sample, 0 before the first */
+  int backoffs;            /* doublings since the last sample */
+};
+
+/* transmissions of one packet */
+struct rtosend {
+  float sent;              /* when it was first sent */
+  float resent;            /* when it was last resent */
+  bool retransmitted;
+};
+
+extern void rto_init(struct rto *, int kind, double initial);
+
+/* the timeout to start the retransmission timer with */
+static inline double rto_current(const struct rto *r)
+{
+  return r->rto;
+}
+
+/* the retransmission timer went off */
+extern void rto_backoff(struct rto *);
+
+/* a packet was sent for the first time, or sent again */
+extern void rto_sent(struct rtosend *, double now);
+extern void rto_resent(struct rtosend *, double now);
+
+/* an ACK for the packet arrived: take a round trip sample if it was
+   only sent once */
+extern void rto_sample(struct rto *, const struct rtosend *, double now);
+
+/* true if the packet was resent and the ACK is too early to be for the
+   last copy, i.e. the resend was spurious */
+extern bool rto_spurious(const struct rto *, const struct rtosend *, double now);
+
+#endif
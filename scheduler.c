@@ -0,0 +1,323 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "scheduler.h"
+
+/* ******************************************************************
+   Event schedulers for the emulator: sorted list, d-ary heap and
+   calendar queue (R. Brown, "Calendar queues", CACM 1988).
+   See scheduler.h for the ordering guarantee shared by all of them.
+**********************************************************************/
+
+#define MINBUCKETS 2
+
+/* true if event a must be handled before event b */
+static int before(const struct event *a, const struct event *b)
+{
+  if (a->evtime != b->evtime)
+    return (a->evtime < b->evtime);
+  return (a->seq > b->seq);   /* newest first, as the original list did */
+}
+
+static void *xmalloc(size_t size)
+{
+  void *p = malloc(size);
+  if (p == NULL) {
+    printf("memory allocation for scheduler failed.");
+    exit(EXIT_FAILURE);
+  }
+  return p;
+}
+
+int sched_kind(const char *name)
+{
+  if (strcmp(name, "list") == 0)
+    return SCHED_LIST;
+  if (strcmp(name, "heap") == 0 || strcmp(name, "heap2") == 0)
+    return SCHED_HEAP;
+  if (strcmp(name, "heap4") == 0)
+    return SCHED_HEAP4;
+  if (strcmp(name, "calendar") == 0)
+    return SCHED_CALENDAR;
+  return -1;
+}
+
+const char *sched_name(int kind)
+{
+  switch (kind) {
+  case SCHED_LIST:     return "list";
+  case SCHED_HEAP:     return "heap";
+  case SCHED_HEAP4:    return "heap4";
+  case SCHED_CALENDAR: return "calendar";
+  }
+  return "unknown";
+}
+
+/********************* sorted list ***********************/
+
+/* insert p in front of the first event that must not go before it */
+static void list_insert(struct event **head, struct event *p)
+{
+  struct event *q, *qold = NULL;
+
+  for (q = *head; q != NULL && before(q, p); q = q->next)
+    qold = q;
+  p->prev = qold;
+  p->next = q;
+  if (q != NULL)
+    q->prev = p;
+  if (qold != NULL)
+    qold->next = p;
+  else
+    *head = p;
+}
+
+static void list_unlink(struct event **head, struct event *p)
+{
+  if (p->prev != NULL)
+    p->prev->next = p->next;
+  else
+    *head = p->next;
+  if (p->next != NULL)
+    p->next->prev = p->prev;
+  p->prev = NULL;
+  p->next = NULL;
+}
+
+/********************* d-ary heap ***********************/
+
+static void heap_siftup(struct scheduler *s, int i)
+{
+  struct event *p = s->heap[i];
+  int parent;
+
+  while (i > 0) {
+    parent = (i - 1) / s->arity;
+    if (!before(p, s->heap[parent]))
+      break;
+    s->heap[i] = s->heap[parent];
+    i = parent;
+  }
+  s->heap[i] = p;
+}
+
+static void heap_siftdown(struct scheduler *s, int i)
+{
+  struct event *p = s->heap[i];
+  int child, best, last;
+
+  for (;;) {
+    child = i * s->arity + 1;
+    if (child >= s->size)
+      break;
+    best = child;
+    last = child + s->arity;
+    if (last > s->size)
+      last = s->size;
+    for (child++; child < last; child++)
+      if (before(s->heap[child], s->heap[best]))
+        best = child;
+    if (!before(s->heap[best], p))
+      break;
+    s->heap[i] = s->heap[best];
+    i = best;
+  }
+  s->heap[i] = p;
+}
+
+static void heap_insert(struct scheduler *s, struct event *p)
+{
+  if (s->size == s->capacity) {
+    s->capacity = s->capacity ? 2 * s->capacity : 64;
+    s->heap = realloc(s->heap, s->capacity * sizeof(struct event *));
+    if (s->heap == NULL) {
+      printf("memory allocation for scheduler failed.");
+      exit(EXIT_FAILURE);
+    }
+  }
+  s->heap[s->size++] = p;
+  heap_siftup(s, s->size - 1);
+}
+
+static struct event *heap_pop(struct scheduler *s)
+{
+  struct event *p = s->heap[0];
+
+  if (--s->size > 0) {
+    s->heap[0] = s->heap[s->size];
+    heap_siftdown(s, 0);
+  }
+  return p;
+}
+
+/********************* calendar queue ***********************/
+
+static long cal_vbucket(const struct scheduler *s, const struct event *p)
+{
+  return (long)floor(p->evtime / s->width);
+}
+
+static struct event **cal_bucket(const struct scheduler *s, const struct event *p)
+{
+  return &s->buckets[cal_vbucket(s, p) & (s->nbuckets - 1)];
+}
+
+/* rebuild the calendar with nbuckets buckets, choosing a bucket width
+   from the spread of the events currently queued */
+static void cal_resize(struct scheduler *s, int nbuckets)
+{
+  struct event *all = NULL, *p, *next;
+  double tmin = 0.0, tmax = 0.0;
+  int i, n = 0;
+
+  for (i = 0; s->buckets != NULL && i < s->nbuckets; i++)
+    for (p = s->buckets[i]; p != NULL; p = next) {
+      next = p->next;
+      if (n == 0 || p->evtime < tmin)
+        tmin = p->evtime;
+      if (n == 0 || p->evtime > tmax)
+        tmax = p->evtime;
+      p->next = all;
+      all = p;
+      n++;
+    }
+
+  free(s->buckets);
+  s->nbuckets = nbuckets;
+  s->buckets = xmalloc(nbuckets * sizeof(struct event *));
+  for (i = 0; i < nbuckets; i++)
+    s->buckets[i] = NULL;
+
+  /* about three events per bucket-width, as suggested by Brown */
+  if (n > 1 && tmax > tmin)
+    s->width = 3.0 * (tmax - tmin) / n;
+  if (s->width <= 0.0)
+    s->width = 1.0;
+  s->lastvb = (long)floor(tmin / s->width);
+
+  for (p = all; p != NULL; p = next) {
+    next = p->next;
+    list_insert(cal_bucket(s, p), p);
+  }
+}
+
+static struct event *cal_pop(struct scheduler *s)
+{
+  struct event *p, *best = NULL;
+  int i;
+
+  /* scan one "year" starting at the bucket of the last dequeue */
+  for (i = 0; i < s->nbuckets; i++) {
+    p = s->buckets[(s->lastvb + i) & (s->nbuckets - 1)];
+    if (p != NULL && cal_vbucket(s, p) == s->lastvb + i) {
+      best = p;
+      break;
+    }
+  }
+  /* nothing due within a year: fall back to a direct search */
+  if (best == NULL)
+    for (i = 0; i < s->nbuckets; i++) {
+      p = s->buckets[i];
+      if (p != NULL && (best == NULL || before(p, best)))
+        best = p;
+    }
+
+  s->lastvb = cal_vbucket(s, best);
+  list_unlink(cal_bucket(s, best), best);
+  return best;
+}
+
+/********************* scheduler interface ***********************/
+
+void sched_init(struct scheduler *s, int kind)
+{
+  memset(s, 0, sizeof(*s));
+  s->kind = kind;
+  s->arity = (kind == SCHED_HEAP4) ? 4 : 2;
+  if (kind == SCHED_CALENDAR)
+    cal_resize(s, MINBUCKETS);
+}
+
+void sched_free(struct scheduler *s)
+{
+  free(s->heap);
+  free(s->buckets);
+  s->heap = NULL;
+  s->buckets = NULL;
+}
+
+void sched_insert(struct scheduler *s, struct event *p)
+{
+  p->seq = s->nextseq++;
+  switch (s->kind) {
+  case SCHED_LIST:
+    list_insert(&s->head, p);
+    s->size++;
+    break;
+  case SCHED_HEAP:
+  case SCHED_HEAP4:
+    heap_insert(s, p);
+    break;
+  case SCHED_CALENDAR:
+    /* an event earlier than the scan position moves the scan back */
+    if (cal_vbucket(s, p) < s->lastvb)
+      s->lastvb = cal_vbucket(s, p);
+    list_insert(cal_bucket(s, p), p);
+    if (++s->size > 2 * s->nbuckets)
+      cal_resize(s, 2 * s->nbuckets);
+    break;
+  }
+}
+
+struct event *sched_pop(struct scheduler *s)
+{
+  struct event *p = NULL;
+
+  if (s->size == 0)
+    return NULL;
+  switch (s->kind) {
+  case SCHED_LIST:
+    p = s->head;
+    list_unlink(&s->head, p);
+    s->size--;
+    break;
+  case SCHED_HEAP:
+  case SCHED_HEAP4:
+    p = heap_pop(s);
+    break;
+  case SCHED_CALENDAR:
+    p = cal_pop(s);
+    if (--s->size < s->nbuckets / 2 && s->nbuckets > MINBUCKETS)
+      cal_resize(s, s->nbuckets / 2);
+    break;
+  }
+  return p;
+}
+
+void sched_foreach(struct scheduler *s, void (*fn)(struct event *, void *), void *arg)
+{
+  struct event *p, *next;
+  int i;
+
+  switch (s->kind) {
+  case SCHED_LIST:
+    for (p = s->head; p != NULL; p = next) {
+      next = p->next;
+      fn(p, arg);
+    }
+    break;
+  case SCHED_HEAP:
+  case SCHED_HEAP4:
+    for (i = 0; i < s->size; i++)
+      fn(s->heap[i], arg);
+    break;
+  case SCHED_CALENDAR:
+    for (i = 0; i < s->nbuckets; i++)
+      for (p = s->buckets[i]; p != NULL; p = next) {
+        next = p->next;
+        fn(p, arg);
+      }
+    break;
+  }
+}
@@ -0,0 +1,73 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+/* ******************************************************************
+   Pending event set used by the emulator.
+
+   The emulator originally kept its events on a sorted doubly linked
+   list, which made every insertion O(number of pending events).  The
+   scheduler below hides the event set behind insert/pop so that the
+   list can be replaced by a d-ary heap or a calendar queue.
+
+   All implementations produce exactly the same order: events are
+   ordered by time, and events with equal time are ordered the way the
+   original list ordered them (a newly inserted event goes in front of
+   events already queued for the same time).  The tie is broken with
+   an insertion sequence number so results do not depend on which
+   scheduler was chosen.
+**********************************************************************/
+
+struct pkt;
+
+struct event {
+  float evtime;           /* event time */
+  int evtype;             /* event type code */
+  int eventity;           /* entity where event occurs */
+  struct pkt *pktptr;     /* ptr to packet (if any) assoc w/ this event */
+  int cancelled;          /* set when a timer is stopped while queued */
+  unsigned long seq;      /* insertion order, used to break time ties */
+  struct event *prev;
+  struct event *next;
+};
+
+/* available scheduler implementations */
+#define SCHED_LIST      0   /* sorted linked list (original emulator) */
+#define SCHED_HEAP      1   /* binary heap */
+#define SCHED_HEAP4     2   /* 4-ary heap */
+#define SCHED_CALENDAR  3   /* calendar queue */
+
+struct scheduler {
+  int kind;
+  int size;                   /* number of queued events */
+  unsigned long nextseq;      /* sequence number for the next insert */
+
+  /* SCHED_LIST */
+  struct event *head;
+
+  /* SCHED_HEAP, SCHED_HEAP4 */
+  struct event **heap;
+  int arity;
+  int capacity;
+
+  /* SCHED_CALENDAR */
+  struct event **buckets;     /* each bucket is a sorted list */
+  int nbuckets;               /* always a power of two */
+  double width;               /* time span covered by one bucket */
+  long lastvb;                /* "virtual" bucket of the last dequeue */
+};
+
+/* parse a scheduler name ("list", "heap", "heap4", "calendar"),
+   returns -1 if the name is unknown */
+extern int sched_kind(const char *name);
+extern const char *sched_name(int kind);
+
+extern void sched_init(struct scheduler *, int kind);
+extern void sched_free(struct scheduler *);  /* queued events are not freed */
+
+extern void sched_insert(struct scheduler *, struct event *);
+extern struct event *sched_pop(struct scheduler *);   /* NULL when empty */
+
+/* visit every queued event (in no particular order) */
+extern void sched_foreach(struct scheduler *, void (*)(struct event *, void *), void *);
+
+#endif
@@ -0,0 +1,87 @@
+#include <stdlib.h>
+#include "emulator.h"
+#include "sendq.h"
+
+/* ******************************************************************
+   Send queue of the sender, see sendq.h.
+**********************************************************************/
+
+void sendq_init(struct sim *s, struct sendq *q)
+{
+  q->limit = s->cfg.sendq;
+  q->policy = s->cfg.sendqpolicy;
+  q->first = q->count = 0;
+  q->size = q->limit;
+  if (q->size > 0) {
+    q->pkts = simalloc(s, q->size * sizeof(struct pkt *));
+    q->times = simalloc(s, q->size * sizeof(float));
+  }
+}
+
+/* add the time at the current depth of all the send queues to the
+   depth statistics, then change it by n; sim_run() adds the last
+   interval */
+static void sendq_changing(struct sim *s, int n)
+{
+  s->stats.queue_area += s->stats.queue_depth * (simtime(s) - s->stats.queue_changed);
+  s->stats.queue_changed = simtime(s);
+  s->stats.queue_depth += n;
+}
+
+/* double the size for backpressure */
+static void sendq_grow(struct sim *s, struct sendq *q)
+{
+  struct pkt **pkts = simalloc(s, 2 * q->size * sizeof(struct pkt *));
+  float *times = simalloc(s, 2 * q->size * sizeof(float));
+  int i;
+
+  for (i = 0; i < q->count; i++) {
+    pkts[i] = q->pkts[(q->first + i) % q->size];
+    times[i] = q->times[(q->first + i) % q->size];
+  }
+  simfree(s, q->pkts);
+  simfree(s, q->times);
+  q->pkts = pkts;
+  q->times = times;
+  q->first = 0;
+  q->size *= 2;
+}
+
+bool sendq_put(struct sim *s, struct sendq *q, const struct msg *message)
+{
+  int i;
+
+  if (q->limit == 0)
+    return false;
+  if (q->count >= q->limit) {
+    if (q->policy == SENDQ_DROPTAIL) {
+      s->stats.queue_drops++;
+      return false;
+    }
+    s->stats.backpressure++;
+    if (q->count == q->size)
+      sendq_grow(s, q);
+  }
+  sendq_changing(s, 1);
+  i = (q->first + q->count++) % q->size;
+  q->pkts[i] = msg_packet(message);
+  q->times[i] = simtime(s);
+  s->stats.queued++;
+  if (q->count > s->stats.queue_max)
+    s->stats.queue_max = q->count;
+  return true;
+}
+
+struct pkt *sendq_get(struct sim *s, struct sendq *q)
+{
+  struct pkt *p;
+
+  if (q->count == 0)
+    return NULL;
+  sendq_changing(s, -1);
+  p = q->pkts[q->first];
+  hdr_record(&s->queuedelay, simtime(s) - q->times[q->first]);
+  q->first = (q->first + 1) % q->size;
+  q->count--;
+  return p;
+}
@@ -0,0 +1,52 @@
+#ifndef SENDQ_H
+#define SENDQ_H
+
+#include <stdbool.h>
+
+/* ******************************************************************
+   Send queue of the sender.
+
+   Without a queue (--sendq 0, the default) a message that arrives
+   while the window is full is refused and counted in window_full.
+   With --sendq N the sender queues up to N such messages, oldest
+   first, and sends them as ACKs open the window.  When the queue is
+   full, --sendq-policy decides:
+   - drop (drop-tail): the new message is refused, counted in
+   window_full and in queue_drops;
+   - backpressure: the new message is queued all the same and counted
+   in backpressure, the number of times layer 5 would have been told
+   to wait; the queue grows as needed.
+   The time each message waits is recorded in the queueing delay
+   histogram, and the depth in queue_max and queue_area (depth times
+   time, for the mean depth).
+**********************************************************************/
+
+struct sim;
+struct msg;
+struct pkt;
+
+struct sendq {
+  struct pkt **pkts;       /* message buffers, see msg_packet() */
+  float *times;            /* when each was queued */
+  int first, count, size;
+  int limit;               /* --sendq, 0 for no queue */
+  int policy;              /* SENDQ_DROPTAIL or SENDQ_BACKPRESSURE, see config.h */
+};
+
+extern void sendq_init(struct sim *, struct sendq *);
+
+/* messages waiting */
+static inline int sendq_count(const struct sendq *q)
+{
+  return q->count;
+}
+
+/* queue a message the window has no room for; false if it is refused,
+   the caller counts that in window_full */
+extern bool sendq_put(struct sim *, struct sendq *, const struct msg *);
+
+/* the oldest message's packet buffer (a reference the caller owns),
+   NULL if the queue is empty */
+extern struct pkt *sendq_get(struct sim *, struct sendq *);
+
+#endif
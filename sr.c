@@ -1,8 +1,17 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <stdbool.h>
+#include <limits.h>
 #include "emulator.h"
 #include "sr.h"
+#include "checksum.h"
+#include "trace.h"
+#include "modulus.h"
+#include "rto.h"
+#include "cc.h"
+#include "sendq.h"
+#include "timer.h"
 
 /* ******************************************************************
    Selective Repeat.
@@ -11,270 +20,801 @@
    Acks are not sent for corrupted packets.
    Also the packets are acked individually, unlike GBN.
    On timeout only the oldest unacked packet is sent. 
+   With --timers packet every outstanding packet has its own deadline
+   instead; the deadlines are kept in a min-heap, the emulator timer
+   is set for the earliest one.  When the oldest outstanding packet is
+   ACKed the later deadlines are put back to a timeout from then, as a
+   single timer would be restarted, so a window that takes longer than
+   the timeout to drain does not all expire.  Of the packets whose
+   deadline has passed a timeout resends the oldest outstanding one and
+   those a later packet's ACK has overtaken, so several losses in one
+   window are recovered in one RTT; the rest wait another timeout.
+   With --sack the receiver only accepts packets within its window and
+   every ACK carries the next sequence number it expects (all before
+   it have arrived) and, in the payload, a bitmap of the packets it
+   holds beyond that, bit i for expected + 1 + i.  One ACK marks all the
+   packets it covers, so a lost ACK rarely costs a resend.
+   SACKs can also be delayed (--delack): B acknowledges every k-th
+   packet received in order, or when its timer goes off, and at once
+   when a packet leaves or fills a gap or is a duplicate.
+   With --cc new packets are only sent while fewer than cwnd are
+   outstanding; timeouts reduce cwnd, and so do CC_DUPSACKS SACKs in a
+   row that leave the window where it is.
+   In full duplex mode (--bidirectional, which needs --sack) both
+   entities send and receive: the A_ routines are the sending half and
+   the B_ routines the receiving half of either.  Data packets carry
+   the cumulative part of the SACK for the other direction in acknum;
+   a SACK is held back for --delack-time and only sent on its own
+   (seqnum NOTINUSE, with the bitmap) if no data leaves in the
+   meantime, or at once for a gap or a duplicate as above.
    SEQSPACE should be atleast 2N to enable window sliding, as in SR it handles out of order packets
    Receive Buffer is used to buffer the packets and send them out in order to the application
 **********************************************************************/
 
+/* defaults of the run time parameters (--rtt, --window, --seqspace) */
 #define RTT  16.0       /* round trip time.  MUST BE SET TO 16.0 when submitting assignment */
 #define WINDOWSIZE 6    /* the maximum number of buffered unacked packet */
-#define SEQSPACE 12      /* the min sequence space for SR must be at least windowsize 2n */
 #define NOTINUSE (-1)   /* used to fill header fields that are not being used */
 
+/* bytes of the SACK bitmap: bits for the window beyond the expected packet */
+#define SACKBYTES(w) (((w) - 1 + 7) / 8)
 
-/* generic procedure to compute the checksum of a packet.  Used by both sender and receiver  
-   the simulator will overwrite part of your packet with 'z's.  It will not overwrite your 
-   original checksum.  This procedure must generate a different checksum to the original if
-   the packet is corrupted.
-*/
-int ComputeChecksum(struct pkt packet)
+static int configure(struct simconfig *cfg)
 {
-  int checksum = 0;
-  int i;
+  if (cfg->windowsize == 0)
+    cfg->windowsize = WINDOWSIZE;
+  if (cfg->seqspace == 0)
+    cfg->seqspace = 2 * cfg->windowsize;
+  if (cfg->rtt == 0.0)
+    cfg->rtt = RTT;
+  /* the min sequence space for SR must be at least windowsize 2n */
+  if (cfg->windowsize < 1 || cfg->seqspace < 2 * cfg->windowsize) {
+    printf("SR needs a sequence space of at least 2 * window (window %d, seqspace %d)\n",
+           cfg->windowsize, cfg->seqspace);
+    return -1;
+  }
+  if (cfg->delack > 1 && !cfg->sack) {
+    printf("SR acknowledges each packet on its own, delayed ACKs need --sack\n");
+    return -1;
+  }
+  if (cfg->bidirectional && !cfg->sack) {
+    printf("SR acknowledges each packet on its own, only SACKs can ride on data (--bidirectional needs --sack)\n");
+    return -1;
+  }
+  if (cfg->sack && SACKBYTES(cfg->windowsize) > cfg->mtu) {
+    printf("the SACK bitmap of a window of %d does not fit an MTU of %d\n",
+           cfg->windowsize, cfg->mtu);
+    return -1;
+  }
+  return 0;
+}
+
+
+/* protocol state of an entity, kept in the simulation as s->state[A]
+   and s->state[B]: A sends and B receives, or both do both */
+struct sender;
+struct receiver;
+
+struct entity {
+  int entity;                     /* A or B */
+  bool duplex;                    /* --bidirectional */
+  struct timers timers;           /* shared by the two halves */
+  struct sender *snd;             /* sending half, if any */
+  struct receiver *rcv;           /* receiving half, if any */
+};
+
+static int B_piggyback(struct sim *, struct receiver *);
 
-  checksum = packet.seqnum;
-  checksum += packet.acknum;
-  for ( i=0; i<20; i++ ) 
-    checksum += (int)(packet.payload[i]);
+/********* Sender (A) variables and functions ************/
+/* sender state, the sending half of an entity */
+struct sender {
+  int entity;                      /* A, or B in full duplex mode */
+  struct timers *timers;           /* the entity's timers */
+  struct receiver *rcv;            /* the receiving half in full duplex mode, else NULL */
+
+  bool *srAcked;    /* adding an array to track each packet which are acknowledged (differs from GBN when they are cumulatively acked) */
+
+  int A_nextseqnum; /* the next sequence number to be used by the sender */
+
+
+  struct pkt **buffer; /* array for storing packets waiting for ACK, indexed by seqnum */
+  struct rtosend *sends;           /* when each of them was sent, indexed by seqnum */
+  int windowfirst, windowlast;     /* array indexes of the first/last packet awaiting ACK */
+  int windowcount;                 /* the number of packets currently awaiting an ACK */
 
-  return checksum;
+  int windowsize;                  /* the maximum number of buffered unacked packet */
+  struct modulus seqspace;         /* wraps sequence numbers */
+  struct rto rto;                  /* retransmission timeout */
+  struct sendq sendq;              /* messages waiting for room in the window */
+  struct cc cc;                    /* congestion window */
+
+  bool sack;                       /* --sack */
+  int dupsacks;                    /* SACKs since the window last moved */
+
+  /* per packet timers (--timers packet) */
+  bool pertimers;
+  float *deadline;                 /* retransmission time, indexed by seqnum */
+  int *heap;                       /* outstanding seqnums, earliest deadline first */
+  int *heappos;                    /* index of a seqnum in heap, -1 if not in it */
+  int heapcount;
+  bool timing;                     /* the emulator timer is running ... */
+  float armed;                     /* ... and goes off at this time */
+  float newest;                    /* latest first send of a packet ACKed so far */
+};
+
+/********* per packet timers ************/
+
+static void heapswap(struct sender *a, int i, int j)
+{
+  int t = a->heap[i];
+
+  a->heap[i] = a->heap[j];
+  a->heap[j] = t;
+  a->heappos[a->heap[i]] = i;
+  a->heappos[a->heap[j]] = j;
 }
 
-bool IsCorrupted(struct pkt packet)
+static void siftup(struct sender *a, int i)
 {
-  if (packet.checksum == ComputeChecksum(packet))
-    return (false);
-  else
-    return (true);
+  while (i > 0 && a->deadline[a->heap[i]] < a->deadline[a->heap[(i - 1) / 2]]) {
+    heapswap(a, i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
 }
 
-   
+static void siftdown(struct sender *a, int i)
+{
+  int child;
+
+  while ((child = 2 * i + 1) < a->heapcount) {
+    if (child + 1 < a->heapcount && a->deadline[a->heap[child + 1]] < a->deadline[a->heap[child]])
+      child++;
+    if (a->deadline[a->heap[child]] >= a->deadline[a->heap[i]])
+      break;
+    heapswap(a, i, child);
+    i = child;
+  }
+}
 
+/* give packet seq a deadline one RTT from now */
+static void deadline_set(struct sim *s, struct sender *a, int seq)
+{
+  /* deadlines are floats like the emulator's clock, so the timer goes
+     off exactly at the earliest one */
+  a->deadline[seq] = (float)(simtime(s) + rto_current(&a->rto));
+  if (a->heappos[seq] < 0) {
+    a->heap[a->heapcount] = seq;
+    a->heappos[seq] = a->heapcount++;
+    siftup(a, a->heapcount - 1);
+  }
+  else
+    siftdown(a, a->heappos[seq]);
+}
 
-/********* Sender (A) variables and functions ************/
-static bool srAcked[SEQSPACE];    /* adding an array to track each packet which are acknowledged (differs from GBN when they are cumulatively acked) */
+static void deadline_clear(struct sender *a, int seq)
+{
+  int i = a->heappos[seq];
 
-static int A_nextseqnum = 0; /* the next sequence number to be used by the sender */
+  if (i < 0)
+    return;
+  a->heappos[seq] = -1;
+  if (i < --a->heapcount) {
+    a->heap[i] = a->heap[a->heapcount];
+    a->heappos[a->heap[i]] = i;
+    siftdown(a, i);
+    siftup(a, i);
+  }
+}
 
+/* the oldest outstanding packet was ACKed: the ones sent after it are
+   still on their way, however long they have been, so none of them
+   times out sooner than a timeout from now.  (Raising every deadline
+   to the same bound keeps the heap in order.) */
+static void deadline_push(struct sim *s, struct sender *a)
+{
+  float bound = (float)(simtime(s) + rto_current(&a->rto));
+  int i;
 
-static struct pkt buffer[SEQSPACE];  /* array for storing packets waiting for ACK */
-static int windowfirst, windowlast;     /* array indexes of the first/last packet awaiting ACK */
-static int windowcount;                 /* the number of packets currently awaiting an ACK */
+  for (i = 0; i < a->heapcount; i++)
+    if (a->deadline[a->heap[i]] < bound)
+      a->deadline[a->heap[i]] = bound;
+}
 
-/* called from layer 5 (application layer), passed the message to be sent to other side */
-void A_output(struct msg message)
+/* set the emulator timer for the earliest deadline, if any */
+static void deadline_arm(struct sim *s, struct sender *a)
 {
-  struct pkt sendpkt;
-  int i;
+  float first;
 
-  /* if not blocked waiting on ACK */
-  if ( windowcount < WINDOWSIZE) {
-    if (TRACE > 1)
-      printf("----A: New message arrives, send window is not full, send new messge to layer3!\n");
+  if (a->heapcount == 0) {
+    if (a->timing)
+      timers_stop(s, a->timers, TIMER_RETRANSMIT);
+    a->timing = false;
+    return;
+  }
+  first = a->deadline[a->heap[0]];
+  if (a->timing && a->armed == first)
+    return;
+  if (a->timing)
+    timers_stop(s, a->timers, TIMER_RETRANSMIT);
+  timers_start(s, a->timers, TIMER_RETRANSMIT, (double)first - simtime(s));
+  a->timing = true;
+  a->armed = first;
+}
 
-    /* create packet */
-    sendpkt.seqnum = A_nextseqnum;
-    sendpkt.acknum = NOTINUSE;
-    for ( i=0; i<20 ; i++ ) 
-      sendpkt.payload[i] = message.data[i];
-    sendpkt.checksum = ComputeChecksum(sendpkt); 
+/* number the message's packet, buffer and send it */
+static void A_send(struct sim *s, struct sender *a, struct pkt *sendpkt)
+{
+  sendpkt->seqnum = a->A_nextseqnum;
+  sendpkt->acknum = a->rcv != NULL ? B_piggyback(s, a->rcv) : NOTINUSE;
+  sendpkt->checksum = ComputeChecksum(s, sendpkt); 
+
+  /* put packet in window buffer */
+  a->buffer[sendpkt->seqnum] = sendpkt;
+  a->srAcked[sendpkt->seqnum] = false;
+  rto_sent(&a->sends[sendpkt->seqnum], simtime(s));
+  a->windowcount++;
+
+  /* send out packet, shared with the window buffer */
+  TRACE_PKT(s, 1, TR_A_SENDING, a->entity, sendpkt);
+  tolayer3_shared (s, a->entity, sendpkt);
+
+  /* start timer if first packet in window */
+  if (a->pertimers) {
+    deadline_set(s, a, sendpkt->seqnum);
+    deadline_arm(s, a);
+  }
+  else if (a->windowcount == 1)
+    timers_start(s, a->timers, TIMER_RETRANSMIT, rto_current(&a->rto));
 
-    /* put packet in window buffer */
-    buffer[sendpkt.seqnum] = sendpkt;
-    srAcked[sendpkt.seqnum] = false;
-    windowcount++;
+  /* get next sequence number, wrap back to 0 */
+  a->A_nextseqnum = wrap(&a->seqspace, a->A_nextseqnum + 1);  
+}
 
-    /* send out packet */
-    if (TRACE > 0)
-      printf("Sending packet %d to layer 3\n", sendpkt.seqnum);
-    tolayer3 (A, sendpkt);
+/* send queued messages while the window has room */
+static void A_drain(struct sim *s, struct sender *a)
+{
+  while (sendq_count(&a->sendq) > 0 && a->windowcount < cc_window(&a->cc))
+    A_send(s, a, sendq_get(s, &a->sendq));
+}
 
-    /* start timer if first packet in window */
-    if (windowcount == 1)
-      starttimer(A,RTT);
+/* a message from layer 5 (application layer) to be sent to other side */
+static void A_message(struct sim *s, struct sender *a, const struct msg *message)
+{
+  /* if not blocked waiting on ACK, or on messages queued before */
+  if (sendq_count(&a->sendq) == 0 && a->windowcount < cc_window(&a->cc)) {
+    TRACE(s, 2, TR_A_SENDNEW, a->entity);
 
-    /* get next sequence number, wrap back to 0 */
-    A_nextseqnum = (A_nextseqnum + 1) % SEQSPACE;  
+    /* create packet around the message, the payload is not copied */
+    A_send(s, a, msg_packet(message));
   }
-  /* if blocked,  window is full */
+  /* if blocked, queue the message if there is room */
+  else if (sendq_put(s, &a->sendq, message))
+    TRACE_VALUE(s, 1, TR_A_QUEUED, a->entity, sendq_count(&a->sendq));
+  /* window (and queue) is full */
   else {
-    if (TRACE > 0)
-      printf("----A: New message arrives, send window is full\n");
-    window_full++;
+    TRACE(s, 1, TR_A_WINDOWFULL, a->entity);
+    s->stats.window_full++;
   }
 }
 
 
-/* called from layer 3, when a packet arrives for layer 4 
-   In this practical this will always be an ACK as B never sends data.
-*/
-void A_input(struct pkt packet)
+/* outstanding packet seq has been acknowledged by a SACK */
+static void sack_mark(struct sim *s, struct sender *a, int seq)
 {
-  int preWinFirst;
-  /* if received ACK is not corrupted */ 
-  if (!IsCorrupted(packet)) {
-    if (TRACE > 0)
-      printf("----A: uncorrupted ACK %d is received\n",packet.acknum);
-    
-    total_ACKs_received++;
-
-    /* check packet Ack is in current window */
-    /* %SEQSPACE is used for wrapping around */
-    if (((packet.acknum - windowfirst + SEQSPACE) % SEQSPACE) < WINDOWSIZE) {
-      if (!srAcked[packet.acknum]) {
-           if (TRACE > 0)
-             printf("----A: ACK %d is not a duplicate\n",packet.acknum);
-            new_ACKs++; 
-            srAcked[packet.acknum] = true;
-          
-          preWinFirst = windowfirst;
-          /* slide window for consecutive acks */
-          while(srAcked[windowfirst] && (windowcount >0)) {
-              srAcked[windowfirst] = false;
-              windowfirst = (windowfirst +1) % SEQSPACE;
-              windowcount--;
-           }
-     
-          /* start timer again if there are still more unacked packets in window */
-          /* Added check to ensure that the timer is stopped and started only if the base is acked*/
-          if (packet.acknum == preWinFirst) {
-            stoptimer(A);
-            if (windowcount > 0)
-              starttimer(A, RTT);
-          }
-       } 
-       else
-          if (TRACE > 0)
-             printf ("----A: duplicate ACK received, do nothing!\n");
-      }
-    }
-  else {
-    if (TRACE > 0)
-      printf ("----A: corrupted ACK is received, do nothing!\n");
-  } 
+  a->srAcked[seq] = true;
+  if (rto_spurious(&a->rto, &a->sends[seq], simtime(s)))
+    s->stats.spurious_resends++;
+  if (a->pertimers) {
+    deadline_clear(a, seq);
+    if (a->sends[seq].sent > a->newest)
+      a->newest = a->sends[seq].sent;
+  }
 }
 
-/* called when A's timer goes off */
-void A_timerinterrupt(void)
+/* a SACK: acknum is the packet the receiver expects next, the payload
+   is a bitmap of the packets it holds beyond that, unless the SACK is
+   carried by a data packet (not pure) */
+static void sack_input(struct sim *s, struct sender *a, const struct pkt *packet, bool pure)
 {
+  int cum, seq, i, last = -1, acked = 0;
+  int bits = pure ? packet->length * 8 : 0;
+  int preWinFirst = a->windowfirst;
+
+  /* packets before acknum; an ACK from before the window started is stale */
+  cum = wrap(&a->seqspace, packet->acknum - a->windowfirst + a->seqspace.n);
+  if (cum > a->windowcount) {
+    TRACE(s, 1, TR_A_DUPACK, a->entity);
+    return;
+  }
+  /* the receiver is missing the first packet: a loss, once per window */
+  if (cum > 0)
+    a->dupsacks = 0;
+  else if (pure && a->windowcount > 0 && ++a->dupsacks == CC_DUPSACKS)
+    cc_loss(s, &a->cc);
+  for (i = 0; i < cum; i++) {
+    seq = wrap(&a->seqspace, a->windowfirst + i);
+    if (!a->srAcked[seq]) {
+      sack_mark(s, a, seq);
+      last = seq;
+      acked++;
+    }
+  }
+  for (i = 0; i < bits; i++) {
+    if (!(packet->payload[i / 8] & (1 << (i % 8))))
+      continue;
+    seq = wrap(&a->seqspace, packet->acknum + 1 + i);
+    if (wrap(&a->seqspace, seq - a->windowfirst + a->seqspace.n) < a->windowcount && !a->srAcked[seq]) {
+      sack_mark(s, a, seq);
+      last = seq;
+      acked++;
+    }
+  }
+  if (acked == 0) {
+    TRACE(s, 1, TR_A_DUPACK, a->entity);
+    return;
+  }
+  TRACE_PKT(s, 1, TR_A_NEWACK, a->entity, packet);
+  s->stats.new_ACKs++;
+  /* the ACK was sent for one of them, most likely the last one sent,
+     which gives the RTT sample; the others' ACKs were not needed */
+  s->stats.acks_saved += acked - 1;
+  rto_sample(&a->rto, &a->sends[last], simtime(s));
+  cc_ack(s, &a->cc, acked);
+
+  /* slide window for consecutive acks */
+  while(a->srAcked[a->windowfirst] && (a->windowcount >0)) {
+    a->srAcked[a->windowfirst] = false;
+    pkt_release(s, a->buffer[a->windowfirst]);
+    a->windowfirst = wrap(&a->seqspace, a->windowfirst +1);
+    a->windowcount--;
+  }
 
-  if (TRACE > 0)
-    printf("----A: time out,resend packets!\n");
+  if (a->pertimers) {
+    if (a->windowfirst != preWinFirst)
+      deadline_push(s, a);
+    deadline_arm(s, a);
+  }
+  else if (a->windowfirst != preWinFirst) {
+    timers_stop(s, a->timers, TIMER_RETRANSMIT);
+    if (a->windowcount > 0)
+      timers_start(s, a->timers, TIMER_RETRANSMIT, rto_current(&a->rto));
+  }
+  A_drain(s, a);
+}
 
+/* an uncorrupted ACK from layer 3: on its own (pure), or carried by a
+   data packet in full duplex mode */
+static void A_ack(struct sim *s, struct sender *a, const struct pkt *packet, bool pure)
+{
+  int preWinFirst;
 
- /* resend only the oldest unacked packet */
-  if (windowcount == 0)
+  TRACE_PKT(s, 1, TR_A_ACK, a->entity, packet);
+  
+  s->stats.total_ACKs_received++;
+
+  if (a->sack) {
+    sack_input(s, a, packet, pure);
     return;
+  }
 
-  if(!srAcked[windowfirst])  {
+  /* check packet Ack is in current window */
+  /* wrap() is used for wrapping around */
+  if (wrap(&a->seqspace, packet->acknum - a->windowfirst + a->seqspace.n) < a->windowsize) {
+    if (!a->srAcked[packet->acknum]) {
+         TRACE_PKT(s, 1, TR_A_NEWACK, a->entity, packet);
+          s->stats.new_ACKs++; 
+          a->srAcked[packet->acknum] = true;
+          if (rto_spurious(&a->rto, &a->sends[packet->acknum], simtime(s)))
+            s->stats.spurious_resends++;
+          rto_sample(&a->rto, &a->sends[packet->acknum], simtime(s));
+          cc_ack(s, &a->cc, 1);
+        
+        preWinFirst = a->windowfirst;
+        /* slide window for consecutive acks */
+        while(a->srAcked[a->windowfirst] && (a->windowcount >0)) {
+            a->srAcked[a->windowfirst] = false;
+            pkt_release(s, a->buffer[a->windowfirst]);
+            a->windowfirst = wrap(&a->seqspace, a->windowfirst +1);
+            a->windowcount--;
+         }
+   
+        /* start timer again if there are still more unacked packets in window */
+        /* Added check to ensure that the timer is stopped and started only if the base is acked*/
+        if (a->pertimers) {
+          deadline_clear(a, packet->acknum);
+          if (a->sends[packet->acknum].sent > a->newest)
+            a->newest = a->sends[packet->acknum].sent;
+          if (packet->acknum == preWinFirst)
+            deadline_push(s, a);
+          deadline_arm(s, a);
+        }
+        else if (packet->acknum == preWinFirst) {
+          timers_stop(s, a->timers, TIMER_RETRANSMIT);
+          if (a->windowcount > 0)
+            timers_start(s, a->timers, TIMER_RETRANSMIT, rto_current(&a->rto));
+        }
+        A_drain(s, a);
+     } 
+     else
+        TRACE(s, 1, TR_A_DUPACK, a->entity);
+    }
+}
 
-    if (TRACE > 0)
-       printf ("---A: resending packet %d\n", buffer[windowfirst].seqnum);
+/* resend packet seq; in full duplex mode it carries the latest SACK
+   for the other direction, not the one it was sent with */
+static void A_resend(struct sim *s, struct sender *a, int seq)
+{
+  if (a->rcv != NULL) {
+    a->buffer[seq] = pkt_writable(s, a->buffer[seq]);
+    a->buffer[seq]->acknum = B_piggyback(s, a->rcv);
+    a->buffer[seq]->checksum = ComputeChecksum(s, a->buffer[seq]);
+  }
+  TRACE_PKT(s, 1, TR_A_RESEND, a->entity, a->buffer[seq]);
+  tolayer3_shared(s, a->entity, a->buffer[seq]);
+  rto_resent(&a->sends[seq], simtime(s));
+  s->stats.packets_resent++;
+}
 
-    tolayer3(A, buffer[windowfirst]);
-     packets_resent++;
+/* called when the retransmission timer goes off */
+static void A_timeout(struct sim *s, struct sender *a)
+{
+  int seq;
+
+  TRACE(s, 1, TR_A_TIMEOUT, a->entity);
+  rto_backoff(&a->rto);
+  cc_timeout(s, &a->cc);
+
+  /* of the packets whose deadline has passed, resend the oldest one
+     outstanding, as with a single timer, and those an ACK for a packet
+     sent after them has overtaken: the medium keeps packets in order,
+     so they are lost.  The others may just be slow, behind a queue the
+     resends would only make longer; they get another timeout. */
+  if (a->pertimers) {
+    a->timing = false;
+    while (a->heapcount > 0 && a->deadline[a->heap[0]] <= simtime(s)) {
+      seq = a->heap[0];
+      if (seq == a->windowfirst || a->sends[seq].resent < a->newest)
+        A_resend(s, a, seq);
+      deadline_set(s, a, seq);
+    }
+    deadline_arm(s, a);
+    return;
   }
-  starttimer(A,RTT);
+
+ /* resend only the oldest unacked packet */
+  if (a->windowcount == 0)
+    return;
+
+  if(!a->srAcked[a->windowfirst])
+    A_resend(s, a, a->windowfirst);
+  timers_start(s, a->timers, TIMER_RETRANSMIT, rto_current(&a->rto));
 
 }       
 
 
 
-/* the following routine will be called once (only) before any other */
-/* entity A routines are called. You can use it to do any initialization */
-void A_init(void)
+/* create the sending half of an entity, once before any other
+   sender routine is called */
+static struct sender *A_create(struct sim *s, struct entity *h)
 {
   /* initialise A's window, base, Timers and packets  */
+  struct sender *a = simalloc(s, sizeof(struct sender));
   int i;
-  A_nextseqnum = 0;  /* A starts with seq num 0 */
-  windowfirst = 0;
-  windowlast = -1;   /* windowlast is where the last packet sent is stored.  
+
+  a->entity = h->entity;
+  a->timers = &h->timers;
+  a->rcv = h->duplex ? h->rcv : NULL;
+  a->windowsize = s->cfg.windowsize;
+  modulus_init(&a->seqspace, s->cfg.seqspace);
+  rto_init(&a->rto, s->cfg.rto, s->cfg.rtt);
+  cc_init(s, &a->cc, s->cfg.cc, a->windowsize);
+  sendq_init(s, &a->sendq);
+  a->buffer = simalloc(s, a->seqspace.n * sizeof(struct pkt *));
+  a->srAcked = simalloc(s, a->seqspace.n * sizeof(bool));
+  a->sends = simalloc(s, a->seqspace.n * sizeof(struct rtosend));
+  a->sack = s->cfg.sack;
+  a->pertimers = (s->cfg.timers == TIMERS_PACKET);
+  a->newest = 0.0;
+  if (a->pertimers) {
+    a->deadline = simalloc(s, a->seqspace.n * sizeof(float));
+    a->heap = simalloc(s, a->windowsize * sizeof(int));
+    a->heappos = simalloc(s, a->seqspace.n * sizeof(int));
+    for (i = 0; i < a->seqspace.n; i++)
+      a->heappos[i] = -1;
+  }
+
+  a->A_nextseqnum = 0;  /* A starts with seq num 0 */
+  a->windowfirst = 0;
+  a->windowlast = -1;   /* windowlast is where the last packet sent is stored.  
 		     new packets are placed in winlast + 1 
 		     so initially this is set to -1
 		   */
-  windowcount = 0;
+  a->windowcount = 0;
 
-  for (i = 0; i < SEQSPACE; i++) {
-       srAcked[i] = false; /* Intializing all packets to false */
+  for (i = 0; i < a->seqspace.n; i++) {
+       a->srAcked[i] = false; /* Intializing all packets to false */
   } 
+  return a;
 }
 
 
 
 /********* Receiver (B)  variables and procedures ************/
-static struct pkt recvBuffer[SEQSPACE]; /* array for storing received packets */
-static bool recvpkt[SEQSPACE]; /* array to flag received packet */
+/* receiver state, the receiving half of an entity */
+struct receiver {
+  int entity;         /* B, or A in full duplex mode */
+  struct timers *timers;
+  bool duplex;        /* pure SACKs have seqnum NOTINUSE */
+
+  const struct pkt **recvBuffer; /* array for storing received packets */
+  bool *recvpkt; /* array to flag received packet */
+  struct modulus seqspace;
+
+  int expectedseqnum; /* the sequence number expected next by the receiver */
+  int B_nextseqnum;   /* the sequence number for the next packets sent by B */
+
+  bool sack;          /* --sack */
+  int windowsize;
+
+  /* delayed SACKs (--delack) */
+  int delack;         /* SACK every delack-th in-order packet */
+  double delacktime;  /* or this long after the first one not acknowledged */
+  int unacked;        /* in-order packets received since the last SACK */
+  bool timing;        /* the ACK timer is running */
+};
+
+/* the SACK for the receiver's current state */
+static void sack_output(struct sim *s, struct receiver *b)
+{
+  struct pkt sendpkt;
+  int i;
 
-static int expectedseqnum; /* the sequence number expected next by the receiver */
-static int B_nextseqnum;   /* the sequence number for the next packets sent by B */
+  if (b->timing)
+    timers_stop(s, b->timers, TIMER_ACK);
+  b->timing = false;
+  b->unacked = 0;
+
+  sendpkt.acknum = b->expectedseqnum;
+  sendpkt.seqnum = b->duplex ? NOTINUSE : 0;
+  sendpkt.length = SACKBYTES(b->windowsize);
+  memset(sendpkt.payload, 0, sendpkt.length);
+  for (i = 0; i < b->windowsize - 1; i++)
+    if (b->recvpkt[wrap(&b->seqspace, b->expectedseqnum + 1 + i)])
+      sendpkt.payload[i / 8] |= 1 << (i % 8);
+  sendpkt.checksum = ComputeChecksum(s, &sendpkt); 
+  s->stats.pure_acks[b->entity]++;
+  tolayer3 (s, b->entity, &sendpkt);
+}
 
-/* called from layer 3, when a packet arrives for layer 4 at B*/
-void B_input(struct pkt packet)
+/* the SACK for a data packet of the sending half to carry, which makes
+   a SACK held back unnecessary; only the cumulative part fits */
+static int B_piggyback(struct sim *s, struct receiver *b)
+{
+  if (b->unacked > 0) {
+    s->stats.piggybacked[b->entity]++;
+    if (b->timing)
+      timers_stop(s, b->timers, TIMER_ACK);
+    b->timing = false;
+    b->unacked = 0;
+  }
+  return b->expectedseqnum;
+}
+
+/* packets are held beyond the next expected one */
+static bool B_gap(const struct receiver *b)
 {
-  struct pkt sendpkt;
   int i;
 
+  for (i = 1; i < b->windowsize; i++)
+    if (b->recvpkt[wrap(&b->seqspace, b->expectedseqnum + i)])
+      return true;
+  return false;
+}
+
+/* a data packet from layer 3, corrupted or not */
+static void B_receive(struct sim *s, struct receiver *b, const struct pkt *packet, bool corrupt)
+{
+  struct pkt sendpkt;
+  bool inorder = false;
+  bool hadgap = B_gap(b);   /* before the packet may fill it */
+
   /* if not corrupted can receive outof order */
-  if  (!IsCorrupted(packet)) {
+  if  (!corrupt) {
 
     /* counting even duplicate Acks*/
-    packets_received++;
+    s->stats.packets_received++;
 
-    if (TRACE > 0)
-      printf("----B: packet %d is correctly received, send ACK!\n",packet.seqnum);
+    TRACE_PKT(s, 1, TR_B_RECEIVED, b->entity, packet);
 
-    if(!recvpkt[packet.seqnum]) {
-      recvpkt[packet.seqnum] = true;
-      recvBuffer[packet.seqnum] = packet; /* Buffering packet*/
+    /* with SACK, a packet from before the window is an old duplicate */
+    if(!b->recvpkt[packet->seqnum] &&
+       (!b->sack || wrap(&b->seqspace, packet->seqnum - b->expectedseqnum + b->seqspace.n) < b->windowsize)) {
+      inorder = (packet->seqnum == b->expectedseqnum);
+      b->recvpkt[packet->seqnum] = true;
+      pkt_hold(packet);
+      b->recvBuffer[packet->seqnum] = packet; /* Buffering packet, shared not copied */
    
      
 
       /* Deliver in-order packets */
-      while(recvpkt[expectedseqnum]) {
-        tolayer5(B, recvBuffer[expectedseqnum].payload);
-        recvpkt[expectedseqnum] = false;
+      while(b->recvpkt[b->expectedseqnum]) {
+        tolayer5(s, b->entity, b->recvBuffer[b->expectedseqnum]->payload, b->recvBuffer[b->expectedseqnum]->length);
+        pkt_release(s, b->recvBuffer[b->expectedseqnum]);
+        b->recvpkt[b->expectedseqnum] = false;
         /* update state variables */
-        expectedseqnum = (expectedseqnum + 1) % SEQSPACE;  
+        b->expectedseqnum = wrap(&b->seqspace, b->expectedseqnum + 1);  
       }    
     }
+    if (b->sack) {
+      /* a delayed SACK waits for more packets in order or the timer */
+      if (inorder && !hadgap && !B_gap(b) && ++b->unacked < b->delack) {
+        if (!b->timing)
+          timers_start(s, b->timers, TIMER_ACK, b->delacktime);
+        b->timing = true;
+        return;
+      }
+      sack_output(s, b);
+      return;
+    }
+
     /* create packet */
-    sendpkt.acknum = packet.seqnum;
+    sendpkt.acknum = packet->seqnum;
     sendpkt.seqnum = 0;
     
-    /* we don't have any data to send.  fill payload with 0's */
-     for ( i=0; i<20 ; i++ ) 
-      sendpkt.payload[i] = '0';  
+    /* we don't have any data to send, an ACK has no payload */
+    sendpkt.length = 0;
 
     /* computer checksum */
-    sendpkt.checksum = ComputeChecksum(sendpkt); 
+    sendpkt.checksum = ComputeChecksum(s, &sendpkt); 
 
     /* send out packet */
-    tolayer3 (B, sendpkt);
+    s->stats.pure_acks[b->entity]++;
+    tolayer3 (s, b->entity, &sendpkt);
   }
 }
 
-/* the following routine will be called once (only) before any other */
-/* entity B routines are called. You can use it to do any initialization */
-void B_init(void)
+/* create the receiving half of an entity, once before any other
+   receiver routine is called */
+static struct receiver *B_create(struct sim *s, struct entity *h)
 {
+  struct receiver *b = simalloc(s, sizeof(struct receiver));
   int i;
-  expectedseqnum = 0;
-  B_nextseqnum = 1;
-  for (i=0; i< SEQSPACE; i++) {
-    recvpkt[i] = false;
+
+  b->entity = h->entity;
+  b->timers = &h->timers;
+  b->duplex = h->duplex;
+  modulus_init(&b->seqspace, s->cfg.seqspace);
+  b->recvBuffer = simalloc(s, b->seqspace.n * sizeof(struct pkt *));
+  b->recvpkt = simalloc(s, b->seqspace.n * sizeof(bool));
+  b->expectedseqnum = 0;
+  b->B_nextseqnum = 1;
+  b->sack = s->cfg.sack;
+  b->windowsize = s->cfg.windowsize;
+  b->delack = s->cfg.delack;
+  b->delacktime = s->cfg.delacktime;
+  /* in full duplex mode every SACK is held back for data to carry it */
+  if (b->duplex && b->delack <= 1)
+    b->delack = INT_MAX;
+  for (i=0; i< b->seqspace.n; i++) {
+    b->recvpkt[i] = false;
+  }
+  return b;
+}
+
+/* called when the ACK timer goes off: the delayed SACK is due */
+static void B_timeout(struct sim *s, struct receiver *b)
+{
+  b->timing = false;
+  if (b->unacked > 0)
+    sack_output(s, b);
+}
+
+/********* Entities A and B ************/
+
+/* the following routine will be called once (only) before any other */
+/* routines of the entity are called */
+static void entity_init(struct sim *s, int AorB)
+{
+  struct entity *h = simalloc(s, sizeof(struct entity));
+
+  s->state[AorB] = h;
+  h->entity = AorB;
+  h->duplex = s->cfg.bidirectional;
+  timers_init(&h->timers, AorB);
+  if (AorB == B || h->duplex)
+    h->rcv = B_create(s, h);
+  if (AorB == A || h->duplex)
+    h->snd = A_create(s, h);
+}
+
+/* called from layer 3, when a packet arrives for layer 4: in simplex
+   mode ACKs for A and data for B, in full duplex mode data packets
+   carrying a SACK as well as pure SACKs */
+static void entity_input(struct sim *s, struct entity *h, const struct pkt *packet)
+{
+  bool corrupt = IsCorrupted(s, packet);
+
+  if (!h->duplex) {
+    if (h->entity == B)
+      B_receive(s, h->rcv, packet, corrupt);
+    else if (!corrupt)
+      A_ack(s, h->snd, packet, true);
+    else
+      TRACE(s, 1, TR_A_CORRUPTACK, A);
+    return;
   }
- 
+  /* the receiver ignores corrupted packets, as in simplex mode */
+  if (!corrupt && packet->acknum != NOTINUSE)
+    A_ack(s, h->snd, packet, packet->seqnum == NOTINUSE);
+  if (corrupt || packet->seqnum != NOTINUSE)
+    B_receive(s, h->rcv, packet, corrupt);
+}
+
+/* called when the entity's timer goes off */
+static void entity_timerinterrupt(struct sim *s, struct entity *h)
+{
+  int expired = timers_expired(s, &h->timers);
+
+  if (expired & (1 << TIMER_RETRANSMIT))
+    A_timeout(s, h->snd);
+  if (expired & (1 << TIMER_ACK))
+    B_timeout(s, h->rcv);
+}
+
+static void A_init(struct sim *s)
+{
+  entity_init(s, A);
 }
 
-/******************************************************************************
- * The following functions need be completed only for bi-directional messages *
- *****************************************************************************/
+static void B_init(struct sim *s)
+{
+  entity_init(s, B);
+}
+
+/* called from layer 5 (application layer), passed the message to be
+   sent to other side; with simplex transfer from A to B there is no
+   B_output() */
+static void entity_output(struct sim *s, struct entity *h, const struct msg *message)
+{
+  if (h->snd != NULL)
+    A_message(s, h->snd, message);
+}
 
-/* Note that with simplex transfer from a-to-B, there is no B_output() */
-void B_output(struct msg message)  
+static void A_output(struct sim *s, const struct msg *message)
 {
+  entity_output(s, s->state[A], message);
 }
 
-/* called when B's timer goes off */
-void B_timerinterrupt(void)
+static void B_output(struct sim *s, const struct msg *message)  
 {
-}
\ No newline at end of file
+  entity_output(s, s->state[B], message);
+}
+
+static void A_input(struct sim *s, const struct pkt *packet)
+{
+  entity_input(s, s->state[A], packet);
+}
+
+static void B_input(struct sim *s, const struct pkt *packet)
+{
+  entity_input(s, s->state[B], packet);
+}
+
+static void A_timerinterrupt(struct sim *s)
+{
+  entity_timerinterrupt(s, s->state[A]);
+}
+
+static void B_timerinterrupt(struct sim *s)
+{
+  entity_timerinterrupt(s, s->state[B]);
+}
+
+const struct protocol sr_protocol = {
+  "sr",
+  configure,
+  A_init, B_init,
+  A_output, B_output,
+  A_input, B_input,
+  A_timerinterrupt, B_timerinterrupt
+};
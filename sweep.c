@@ -0,0 +1,397 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include "sweep.h"
+#include "emulator.h"
+#include "report.h"
+
+/* ******************************************************************
+   Parameter sweeps.
+
+   A grid file uses the config file syntax, but any parameter may list
+   several comma separated values:
+
+     messages = 10000
+     loss = 0.0, 0.1, 0.2, 0.3
+     corrupt = 0.0, 0.1
+     lambda = 5, 10, 20
+     window = 4, 8, 16, 32
+     protocol = gbn, sr
+     direction = 2
+     replications = 20
+     report = results.csv
+     format = csv
+
+   Every combination of the listed values is a grid point, and every
+   point is simulated "replications" times.  Replication r uses the
+   random streams of replication number "replication" + r of the seed,
+   or seed + r with "rng = compat", which cannot split streams.
+
+   The runs are spread over a pool of worker threads.  Each worker owns
+   a deque of runs; it takes runs from the front of its own deque and,
+   once that is empty, steals from the back of another worker's deque,
+   so the load stays balanced however long the individual runs take.
+
+   As soon as all replications of a point have finished, one row with
+   the point's parameters and the mean of every counter is appended to
+   the report, so results stream out while the sweep is running.
+**********************************************************************/
+
+#define MAXAXES   16
+#define MAXVALUES 256
+
+struct axis {
+  char *key;
+  char *list;                       /* storage for the values */
+  int nvalues;
+  char *values[MAXVALUES];
+};
+
+/* accumulated results of one grid point */
+struct point {
+  int done;                         /* replications finished */
+  int nitems;
+  const char *names[REPORT_MAXITEMS];
+  double sum[REPORT_MAXITEMS];
+  double sumsq[REPORT_MAXITEMS];
+};
+
+/* a worker's deque of runs, a run is point * replications + replication */
+struct deque {
+  pthread_mutex_t lock;
+  int *runs;
+  int front, back;                  /* runs[front..back-1] are pending */
+};
+
+struct sweep {
+  struct simconfig base;            /* parameters shared by all points */
+  struct axis axes[MAXAXES];
+  int naxes;
+  int replications;
+  int npoints;
+  int nthreads;
+
+  struct deque *deques;
+  struct point *points;
+  pthread_mutex_t lock;             /* protects points and the output */
+  FILE *out;
+  int format;
+  int header;                       /* CSV header still to be written */
+};
+
+struct worker {
+  struct sweep *sw;
+  int id;
+};
+
+static char *copystring(const char *s)
+{
+  char *copy = malloc(strlen(s) + 1);
+  if (copy == NULL) {
+    printf("memory allocation for sweep failed.");
+    exit(EXIT_FAILURE);
+  }
+  strcpy(copy, s);
+  return copy;
+}
+
+/* config_set() with a value of an axis.  config_set keeps a copy of a
+   string value; use the axis' own, which lasts as long as the sweep,
+   rather than leak a copy per run. */
+static int setvalue(struct simconfig *cfg, const char *key, const char *value)
+{
+  const char **strings[4];
+  const char *before[4];
+  int j;
+
+  strings[0] = &cfg->cwndlog;
+  strings[1] = &cfg->tracefile;
+  strings[2] = &cfg->report;
+  strings[3] = &cfg->sweep;
+  for (j = 0; j < 4; j++)
+    before[j] = *strings[j];
+  if (config_set(cfg, key, value) != 0)
+    return -1;
+  for (j = 0; j < 4; j++)
+    if (*strings[j] != before[j]) {
+      free((char *)*strings[j]);
+      *strings[j] = value;
+    }
+  return 0;
+}
+
+/* config_read() callback: a single value goes into the base parameters,
+   a comma separated list becomes an axis of the grid */
+static int setgrid(void *arg, const char *key, const char *value)
+{
+  struct sweep *sw = arg;
+  struct axis *axis;
+  char *list, *v, *end;
+
+  if (strchr(value, ',') == NULL)
+    return config_set(&sw->base, key, value);
+
+  if (sw->naxes == MAXAXES)
+    return -1;
+  axis = &sw->axes[sw->naxes++];
+  axis->key = copystring(key);
+  axis->nvalues = 0;
+  list = axis->list = copystring(value);
+  for (v = strtok(list, ","); v != NULL; v = strtok(NULL, ",")) {
+    while (*v == ' ' || *v == '\t')
+      v++;
+    for (end = v + strlen(v); end > v && (end[-1] == ' ' || end[-1] == '\t'); end--)
+      ;
+    *end = '\0';
+    /* check the value now rather than in a worker thread */
+    if (axis->nvalues == MAXVALUES || setvalue(&sw->base, key, v) != 0)
+      return -1;
+    axis->values[axis->nvalues++] = v;
+  }
+  return axis->nvalues > 0 ? 0 : -1;
+}
+
+/* parameters of grid point p: the base values with one value per axis */
+static void pointconfig(const struct sweep *sw, int p, struct simconfig *cfg)
+{
+  int i;
+
+  *cfg = sw->base;
+  for (i = sw->naxes - 1; i >= 0; i--) {
+    setvalue(cfg, sw->axes[i].key, sw->axes[i].values[p % sw->axes[i].nvalues]);
+    p /= sw->axes[i].nvalues;
+  }
+}
+
+/* write the aggregated row of a finished point, called with sw->lock held */
+static void writepoint(struct sweep *sw, int p)
+{
+  struct point *pt = &sw->points[p];
+  struct simconfig cfg;
+  struct report r;
+  double mean, var;
+  int i;
+
+  pointconfig(sw, p, &cfg);
+  sim_configure(&cfg);
+  report_init(&r);
+  report_int(&r, "point", p);
+  config_report(&cfg, &r);
+  report_int(&r, "replications", pt->done);
+  for (i = 0; i < pt->nitems; i++)
+    report_real(&r, pt->names[i], pt->sum[i] / pt->done);
+  for (i = 0; i < pt->nitems; i++)
+    if (strcmp(pt->names[i], "goodput") == 0) {
+      mean = pt->sum[i] / pt->done;
+      var = pt->done > 1 ? (pt->sumsq[i] - pt->done * mean * mean) / (pt->done - 1) : 0.0;
+      report_real(&r, "goodput_sd", var > 0.0 ? sqrt(var) : 0.0);
+    }
+  report_write(&r, sw->out, sw->format, sw->header);
+  fflush(sw->out);
+  sw->header = 0;
+}
+
+static void runone(struct sweep *sw, int run)
+{
+  struct simconfig cfg;
+  struct report r;
+  struct point *pt;
+  struct sim *s;
+  int p = run / sw->replications;
+  int i;
+  double v;
+
+  pointconfig(sw, p, &cfg);
+  if (cfg.rng == RNG_COMPAT)
+    cfg.seed += run % sw->replications;
+  else
+    cfg.replication += run % sw->replications;
+  s = sim_create(&cfg);
+  sim_run(s);
+  report_init(&r);
+  sim_report(s, &r);
+  sim_destroy(s);
+
+  pthread_mutex_lock(&sw->lock);
+  pt = &sw->points[p];
+  pt->nitems = r.nitems;
+  for (i = 0; i < r.nitems; i++) {
+    v = r.items[i].kind == 'i' ? (double)r.items[i].ival : r.items[i].fval;
+    pt->names[i] = r.items[i].name;
+    pt->sum[i] += v;
+    pt->sumsq[i] += v * v;
+  }
+  if (++pt->done == sw->replications)
+    writepoint(sw, p);
+  pthread_mutex_unlock(&sw->lock);
+}
+
+/* next run for worker id: from the front of its own deque, otherwise
+   stolen from the back of another worker's; -1 when no work is left */
+static int nextrun(struct sweep *sw, int id)
+{
+  struct deque *d;
+  int i, run = -1;
+
+  d = &sw->deques[id];
+  pthread_mutex_lock(&d->lock);
+  if (d->front < d->back)
+    run = d->runs[d->front++];
+  pthread_mutex_unlock(&d->lock);
+
+  for (i = 1; run < 0 && i < sw->nthreads; i++) {
+    d = &sw->deques[(id + i) % sw->nthreads];
+    pthread_mutex_lock(&d->lock);
+    if (d->front < d->back)
+      run = d->runs[--d->back];
+    pthread_mutex_unlock(&d->lock);
+  }
+  return run;
+}
+
+static void *worker(void *arg)
+{
+  struct worker *w = arg;
+  int run;
+
+  /* runs are only ever removed, so an empty sweep means we are done */
+  while ((run = nextrun(w->sw, w->id)) >= 0)
+    runone(w->sw, run);
+  return NULL;
+}
+
+static int ncores(void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  if (n > 0)
+    return (int)n;
+#endif
+  return 1;
+}
+
+static double wallclock(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int sweep_run(const struct simconfig *cfg)
+{
+  struct sweep sw;
+  struct simconfig point;
+  struct worker *workers;
+  pthread_t *threads;
+  double start;
+  int i, j, nruns, per;
+
+  memset(&sw, 0, sizeof(sw));
+  sw.base = *cfg;
+  sw.base.sweep = NULL;
+  if (config_read(cfg->sweep, setgrid, &sw) != 0)
+    return -1;
+  sw.replications = sw.base.replications;
+  if (!(sw.base.given & CFG_MESSAGES) || !(sw.base.given & CFG_LAMBDA)) {
+    printf("%s: a sweep needs at least messages and lambda\n", cfg->sweep);
+    return -1;
+  }
+  sw.base.given |= CFG_MESSAGES | CFG_LOSS | CFG_CORRUPT | CFG_DIRECTION | CFG_LAMBDA | CFG_TRACE;
+  sw.base.trace = 0;   /* tracing from many threads at once is unreadable */
+  sw.base.tracefile = NULL;
+  sw.base.cwndlog = NULL;
+
+  sw.npoints = 1;
+  for (i = 0; i < sw.naxes; i++)
+    sw.npoints *= sw.axes[i].nvalues;
+  /* check every point before starting, e.g. that each window fits the
+     sequence space */
+  for (i = 0; i < sw.npoints; i++) {
+    pointconfig(&sw, i, &point);
+    if (sim_configure(&point) != 0) {
+      printf("%s: invalid parameters at grid point %d\n", cfg->sweep, i);
+      return -1;
+    }
+  }
+  nruns = sw.npoints * sw.replications;
+  sw.nthreads = sw.base.threads > 0 ? sw.base.threads : ncores();
+  if (sw.nthreads > nruns)
+    sw.nthreads = nruns;
+
+  sw.format = sw.base.reportformat;
+  if (sw.base.report == NULL || strcmp(sw.base.report, "-") == 0) {
+    sw.out = stdout;
+    sw.header = 1;
+  }
+  else {
+    if ((sw.out = fopen(sw.base.report, "a")) == NULL) {
+      printf("cannot open report file %s\n", sw.base.report);
+      return -1;
+    }
+    fseek(sw.out, 0, SEEK_END);
+    sw.header = (ftell(sw.out) == 0);
+  }
+
+  /* deal the runs out in contiguous blocks, so a worker finishes all
+     replications of a point together unless its work gets stolen */
+  sw.points = calloc(sw.npoints, sizeof(struct point));
+  sw.deques = calloc(sw.nthreads, sizeof(struct deque));
+  workers = calloc(sw.nthreads, sizeof(struct worker));
+  threads = calloc(sw.nthreads, sizeof(pthread_t));
+  if (sw.points == NULL || sw.deques == NULL || workers == NULL || threads == NULL) {
+    printf("memory allocation for sweep failed.");
+    exit(EXIT_FAILURE);
+  }
+  per = (nruns + sw.nthreads - 1) / sw.nthreads;
+  for (i = 0; i < sw.nthreads; i++) {
+    struct deque *d = &sw.deques[i];
+    pthread_mutex_init(&d->lock, NULL);
+    d->runs = malloc(per * sizeof(int));
+    if (d->runs == NULL) {
+      printf("memory allocation for sweep failed.");
+      exit(EXIT_FAILURE);
+    }
+    for (j = i * per; j < nruns && j < (i + 1) * per; j++)
+      d->runs[d->back++] = j;
+  }
+  pthread_mutex_init(&sw.lock, NULL);
+
+  start = wallclock();
+  for (i = 0; i < sw.nthreads; i++) {
+    workers[i].sw = &sw;
+    workers[i].id = i;
+    if (pthread_create(&threads[i], NULL, worker, &workers[i]) != 0) {
+      printf("cannot start sweep thread\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (i = 0; i < sw.nthreads; i++)
+    pthread_join(threads[i], NULL);
+
+  /* with --report - the rows are on stdout, keep it machine readable */
+  if (sw.out != stdout) {
+    fclose(sw.out);
+    printf("sweep: %d points x %d replications on %d threads in %.2f s\n",
+           sw.npoints, sw.replications, sw.nthreads, wallclock() - start);
+  }
+
+  for (i = 0; i < sw.nthreads; i++) {
+    pthread_mutex_destroy(&sw.deques[i].lock);
+    free(sw.deques[i].runs);
+  }
+  pthread_mutex_destroy(&sw.lock);
+  for (i = 0; i < sw.naxes; i++) {
+    free(sw.axes[i].key);
+    free(sw.axes[i].list);
+  }
+  free(sw.deques);
+  free(sw.points);
+  free(workers);
+  free(threads);
+  return 0;
+}
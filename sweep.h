@@ -0,0 +1,11 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "config.h"
+
+/* run the parameter grid named by cfg->sweep on cfg->threads worker
+   threads, streaming one aggregated row per grid point to cfg->report
+   (stdout if not set); returns 0 on success */
+extern int sweep_run(const struct simconfig *cfg);
+
+#endif
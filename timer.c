@@ -0,0 +1,67 @@
+#include <math.h>
+#include "emulator.h"
+#include "timer.h"
+
+/* ******************************************************************
+   The two timers of an entity, see timer.h.
+**********************************************************************/
+
+void timers_init(struct timers *t, int entity)
+{
+  t->entity = entity;
+  t->set[TIMER_RETRANSMIT] = t->set[TIMER_ACK] = false;
+  t->running = false;
+  t->armed = TIMER_RETRANSMIT;
+}
+
+static void arm(struct sim *s, struct timers *t, int which, double increment)
+{
+  starttimer(s, t->entity, increment);
+  t->running = true;
+  t->armed = which;
+}
+
+void timers_start(struct sim *s, struct timers *t, int which, double increment)
+{
+  t->due[which] = simtime(s) + increment;
+  t->set[which] = true;
+  if (t->running) {
+    /* the other one goes off first, ours waits behind it */
+    if (t->armed != which && t->due[t->armed] <= t->due[which])
+      return;
+    stoptimer(s, t->entity);
+  }
+  arm(s, t, which, increment);
+}
+
+void timers_stop(struct sim *s, struct timers *t, int which)
+{
+  int other = 1 - which;
+
+  if (!t->set[which])
+    return;
+  t->set[which] = false;
+  if (!t->running || t->armed != which)
+    return;
+  stoptimer(s, t->entity);
+  t->running = false;
+  if (t->set[other])
+    arm(s, t, other, fmax(t->due[other] - simtime(s), 0.0));
+}
+
+int timers_expired(struct sim *s, struct timers *t)
+{
+  double due = t->due[t->armed];
+  int which, fired = 0;
+
+  t->running = false;
+  for (which = 0; which < 2; which++)
+    if (t->set[which] && t->due[which] <= due) {
+      t->set[which] = false;
+      fired |= 1 << which;
+    }
+  for (which = 0; which < 2; which++)
+    if (t->set[which])
+      arm(s, t, which, fmax(t->due[which] - simtime(s), 0.0));
+  return fired;
+}
@@ -0,0 +1,41 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdbool.h>
+
+/* ******************************************************************
+   The two timers of an entity.
+
+   The emulator gives each entity a single timer.  In full duplex
+   mode (--bidirectional) an entity both sends, with a retransmission
+   timer, and receives, holding back ACKs with a second timer, so the
+   protocols keep both deadlines here and the emulator timer is set for
+   the earlier one.  With only one of them in use every call maps to
+   one starttimer() or stoptimer(), as the protocols made before.
+**********************************************************************/
+
+struct sim;
+
+#define TIMER_RETRANSMIT 0     /* the sending half's retransmission timer */
+#define TIMER_ACK        1     /* the receiving half's ACK hold timer */
+
+struct timers {
+  int entity;              /* A or B */
+  double due[2];           /* when each goes off ... */
+  bool set[2];             /* ... if it is set */
+  bool running;            /* the emulator timer is started ... */
+  int armed;               /* ... for this one */
+};
+
+extern void timers_init(struct timers *, int entity);
+
+/* set timer which to go off increment from now, replacing any earlier
+   setting, or clear it */
+extern void timers_start(struct sim *, struct timers *, int which, double increment);
+extern void timers_stop(struct sim *, struct timers *, int which);
+
+/* the emulator timer went off: clear and return the set of timers
+   (1 << which) that are due, restarting it for any other */
+extern int timers_expired(struct sim *, struct timers *);
+
+#endif
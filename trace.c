@@ -0,0 +1,252 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "trace.h"
+
+/* ******************************************************************
+   Trace records, see trace.h.
+**********************************************************************/
+
+#define TRACE_RING 8192          /* slots, a power of two */
+
+/* a record or the data that follows it */
+union trace_slot {
+  struct trace_record rec;
+  struct trace_data data;
+};
+
+struct tracelog {
+  FILE *f;
+  const char *path;
+  unsigned head, tail;           /* slots written and slots filled, mod 2^32 */
+  union trace_slot ring[TRACE_RING];
+};
+
+const unsigned char trace_levels[TR_NCODES] = {
+  /* TR_RANDOM */ 4, /* TR_INSERTEVENT */ 3, /* TR_ARRIVAL */ 3,
+  /* TR_STOPTIMER */ 2, /* TR_STARTTIMER */ 2, /* TR_LOST */ 1,
+  /* TR_QUEUEDROP */ 1,
+  /* TR_TOLAYER3 */ 3, /* TR_CORRUPTED */ 1, /* TR_SCHEDULED */ 3,
+  /* TR_TOLAYER5 */ 3, /* TR_EVENT */ 2, /* TR_GIVEN */ 3, /* TR_NOMORE */ 3,
+  /* TR_A_SENDNEW */ 2, /* TR_A_SENDING */ 1, /* TR_A_WINDOWFULL */ 1,
+  /* TR_A_QUEUED */ 1,
+  /* TR_A_ACK */ 1, /* TR_A_NEWACK */ 1, /* TR_A_DUPACK */ 1,
+  /* TR_A_CORRUPTACK */ 1, /* TR_A_TIMEOUT */ 1, /* TR_A_RESEND */ 1,
+  /* TR_A_FASTRETRANSMIT */ 1,
+  /* TR_B_RECEIVED */ 1, /* TR_B_REJECTED */ 1
+};
+
+/* write out the oldest n slots of the ring, in at most two pieces */
+static void flush(struct tracelog *t, unsigned n)
+{
+  unsigned at = t->head % TRACE_RING;
+  unsigned piece = n < TRACE_RING - at ? n : TRACE_RING - at;
+
+  if (fwrite(&t->ring[at], sizeof(union trace_slot), piece, t->f) != piece
+      || fwrite(t->ring, sizeof(union trace_slot), n - piece, t->f) != n - piece) {
+    printf("cannot write trace file %s\n", t->path);
+    exit(EXIT_FAILURE);
+  }
+  t->head += n;
+}
+
+/* the next free slot of the ring, making room if it is full */
+static union trace_slot *slot(struct tracelog *t)
+{
+  if (t->tail - t->head == TRACE_RING)
+    flush(t, TRACE_RING / 2);
+  return &t->ring[t->tail++ % TRACE_RING];
+}
+
+void trace_point(struct sim *s, int code, int entity, const struct pkt *p,
+                 double value, const char *data, int length, int type)
+{
+  struct trace_record rec, *r;
+  struct trace_data dat, *d = &dat;
+
+  r = s->tracelog != NULL ? &slot(s->tracelog)->rec : &rec;
+  r->time = s->time;
+  r->code = code;
+  r->entity = entity;
+  r->type = type;
+  r->flags = 0;
+  r->value = value;
+  r->seq = r->ack = 0;
+  if (p != NULL) {
+    r->flags |= TRF_PKT;
+    r->seq = p->seqnum;
+    r->ack = p->acknum;
+    r->value = p->checksum;
+    data = p->payload;
+    length = p->length;
+  }
+  if (data != NULL) {
+    r->flags |= TRF_DATA;
+    if (s->tracelog != NULL)
+      d = &slot(s->tracelog)->data;
+    d->length = length;
+    memset(d->data, 0, sizeof(d->data));
+    memcpy(d->data, data, length < (int)sizeof(d->data) ? length : (int)sizeof(d->data));
+  }
+
+  if (s->tracelog == NULL)
+    trace_render(stdout, r, data != NULL ? d : NULL);
+}
+
+int trace_open(struct sim *s, const char *path)
+{
+  struct trace_header h;
+  struct tracelog *t;
+
+  t = malloc(sizeof(struct tracelog));
+  if (t == NULL) {
+    printf("memory allocation for trace failed.");
+    exit(EXIT_FAILURE);
+  }
+  if ((t->f = fopen(path, "wb")) == NULL) {
+    printf("cannot open trace file %s\n", path);
+    free(t);
+    return -1;
+  }
+  t->path = path;
+  t->head = t->tail = 0;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, TRACE_MAGIC, sizeof(h.magic));
+  h.version = TRACE_VERSION;
+  h.recsize = sizeof(union trace_slot);
+  if (fwrite(&h, sizeof(h), 1, t->f) != 1) {
+    printf("cannot write trace file %s\n", path);
+    exit(EXIT_FAILURE);
+  }
+  s->tracelog = t;
+  return 0;
+}
+
+void trace_close(struct sim *s)
+{
+  struct tracelog *t = s->tracelog;
+
+  if (t == NULL)
+    return;
+  flush(t, t->tail - t->head);
+  fclose(t->f);
+  free(t);
+  s->tracelog = NULL;
+}
+
+/* the start of the payload, longer payloads are cut off at 20 bytes */
+static void printdata(FILE *f, const struct trace_data *d)
+{
+  int i;
+
+  for (i=0; d != NULL && i<d->length && i<(int)sizeof(d->data); i++)
+    putc(d->data[i], f);
+}
+
+/* the entity of a protocol trace point: in full duplex mode both
+   send and receive */
+#define ENTITY(r) ((r)->entity == A ? 'A' : 'B')
+
+void trace_render(FILE *f, const struct trace_record *r, const struct trace_data *d)
+{
+  switch (r->code) {
+  case TR_RANDOM:
+    fprintf(f, "RANDOM NUMBER GENERAION CALLED: %f\n", r->value);
+    break;
+  case TR_INSERTEVENT:
+    fprintf(f, "            INSERTEVENT: time is %f\n", r->time);
+    fprintf(f, "            INSERTEVENT: future time will be %f\n", r->value);
+    break;
+  case TR_ARRIVAL:
+    fprintf(f, "          GENERATE NEXT ARRIVAL: creating new arrival\n");
+    break;
+  case TR_STOPTIMER:
+    fprintf(f, "          STOP TIMER: stopping timer at %f\n", r->time);
+    break;
+  case TR_STARTTIMER:
+    fprintf(f, "          START TIMER: starting timer at %f\n", r->time);
+    break;
+  case TR_LOST:
+    fprintf(f, "          TOLAYER3: packet being lost\n");
+    break;
+  case TR_QUEUEDROP:
+    fprintf(f, "          TOLAYER3: packet dropped by the link queue (%d queued)\n", (int)r->value);
+    break;
+  case TR_TOLAYER3:
+    fprintf(f, "          TOLAYER3: seq: %d, ack %d, check: %d ", r->seq, r->ack, (int)r->value);
+    printdata(f, d);
+    fprintf(f, "\n");
+    break;
+  case TR_CORRUPTED:
+    fprintf(f, "          TOLAYER3: packet being corrupted\n");
+    break;
+  case TR_SCHEDULED:
+    fprintf(f, "          TOLAYER3: scheduling arrival on other side\n");
+    break;
+  case TR_TOLAYER5:
+    fprintf(f, "          TOLAYER5: data received by application at %c: ", ENTITY(r));
+    printdata(f, d);
+    fprintf(f, "\n");
+    break;
+  case TR_EVENT:
+    fprintf(f, "\nEVENT time: %f,  type: %d", r->value, r->type);
+    if (r->type == 0)
+      fprintf(f, ", timerinterrupt  ");
+    else if (r->type == 1)
+      fprintf(f, ", fromlayer5 ");
+    else
+      fprintf(f, ", fromlayer3 ");
+    fprintf(f, " entity: %d\n", r->entity);
+    break;
+  case TR_GIVEN:
+    fprintf(f, "          MAINLOOP: data given to student: ");
+    printdata(f, d);
+    fprintf(f, "\n");
+    break;
+  case TR_NOMORE:
+    fprintf(f, "          FROM_LAYER5: no more messages to send: \n");
+    break;
+
+  case TR_A_SENDNEW:
+    fprintf(f, "----%c: New message arrives, send window is not full, send new messge to layer3!\n", ENTITY(r));
+    break;
+  case TR_A_SENDING:
+    fprintf(f, "Sending packet %d to layer 3\n", r->seq);
+    break;
+  case TR_A_WINDOWFULL:
+    fprintf(f, "----%c: New message arrives, send window is full\n", ENTITY(r));
+    break;
+  case TR_A_QUEUED:
+    fprintf(f, "----%c: New message arrives, send window is full, %d messages queued\n", ENTITY(r), (int)r->value);
+    break;
+  case TR_A_ACK:
+    fprintf(f, "----%c: uncorrupted ACK %d is received\n", ENTITY(r), r->ack);
+    break;
+  case TR_A_NEWACK:
+    fprintf(f, "----%c: ACK %d is not a duplicate\n", ENTITY(r), r->ack);
+    break;
+  case TR_A_DUPACK:
+    fprintf(f, "----%c: duplicate ACK received, do nothing!\n", ENTITY(r));
+    break;
+  case TR_A_CORRUPTACK:
+    fprintf(f, "----%c: corrupted ACK is received, do nothing!\n", ENTITY(r));
+    break;
+  case TR_A_TIMEOUT:
+    fprintf(f, "----%c: time out,resend packets!\n", ENTITY(r));
+    break;
+  case TR_A_RESEND:
+    fprintf(f, "---%c: resending packet %d\n", ENTITY(r), r->seq);
+    break;
+  case TR_A_FASTRETRANSMIT:
+    fprintf(f, "----%c: %d duplicate ACKs, fast retransmit!\n", ENTITY(r), (int)r->value);
+    break;
+  case TR_B_RECEIVED:
+    fprintf(f, "----%c: packet %d is correctly received, send ACK!\n", ENTITY(r), r->seq);
+    break;
+  case TR_B_REJECTED:
+    fprintf(f, "----%c: packet corrupted or not expected sequence number, resend ACK!\n", ENTITY(r));
+    break;
+  default:
+    fprintf(f, "unknown trace record %d at time %f\n", r->code, r->time);
+  }
+}
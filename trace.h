@@ -0,0 +1,133 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include "emulator.h"
+
+/* ******************************************************************
+   Trace points.
+
+   Every trace message of the emulator and the protocols is a trace
+   point with a level: it fires when the run's TRACE is at least that
+   level.  Trace points above the build level TRACE_BUILD are constant
+   false and generate no code at all.  By default TRACE_BUILD is 0, so
+   there is no trace branch left in the hot paths; build with
+   -DTRACE_BUILD=4 to be able to trace at every level.
+
+   A trace point fills in a 24-byte record: time, message code, entity,
+   event type, flags, seq and ack, and a value.  One that carries data
+   (a packet or a message) is followed by a second 24-byte slot with
+   the data's length and its first 20 bytes.  By default the record is
+   rendered as text on stdout straight away, with exactly the messages
+   the emulator has always printed.  With --trace-file the slots go
+   into a ring buffer instead, and whenever it fills its older half is
+   written to the file in one go; tracedump renders such a file as the
+   same text afterwards.
+**********************************************************************/
+
+/* trace points with a level above TRACE_BUILD are compiled out */
+#ifndef TRACE_BUILD
+#define TRACE_BUILD 0
+#endif
+
+/* message codes */
+enum trace_code {
+  /* emulator */
+  TR_RANDOM,            /* value: random number */
+  TR_INSERTEVENT,       /* value: time of the new event */
+  TR_ARRIVAL,
+  TR_STOPTIMER,
+  TR_STARTTIMER,
+  TR_LOST,
+  TR_QUEUEDROP,         /* value: packets in the link queue */
+  TR_TOLAYER3,          /* packet */
+  TR_CORRUPTED,
+  TR_SCHEDULED,
+  TR_TOLAYER5,          /* entity, data */
+  TR_EVENT,             /* value: event time, type, entity */
+  TR_GIVEN,             /* data */
+  TR_NOMORE,
+
+  /* protocols */
+  TR_A_SENDNEW,
+  TR_A_SENDING,         /* packet */
+  TR_A_WINDOWFULL,
+  TR_A_QUEUED,          /* value: messages in the send queue */
+  TR_A_ACK,             /* packet */
+  TR_A_NEWACK,          /* packet */
+  TR_A_DUPACK,
+  TR_A_CORRUPTACK,
+  TR_A_TIMEOUT,
+  TR_A_RESEND,          /* packet */
+  TR_A_FASTRETRANSMIT,  /* value: duplicate ACKs */
+  TR_B_RECEIVED,        /* packet */
+  TR_B_REJECTED,
+
+  TR_NCODES
+};
+
+/* level of each message code, as in the trace points */
+extern const unsigned char trace_levels[TR_NCODES];
+
+/* bits of trace_record.flags */
+#define TRF_PKT   0x01      /* seq and ack are set, value is the checksum */
+#define TRF_DATA  0x02      /* a trace_data slot follows */
+
+struct trace_record {
+  double value;             /* the trace point's value, or the checksum */
+  float time;               /* simulation time */
+  unsigned char code;       /* TR_* */
+  unsigned char entity;     /* A or B */
+  unsigned char type;       /* event type of TR_EVENT */
+  unsigned char flags;      /* TRF_* */
+  int seq;
+  int ack;
+};
+
+/* the data of the record before it, cut off at 20 bytes */
+struct trace_data {
+  int length;
+  char data[20];
+};
+
+/* binary trace files start with this header, followed by records,
+   each with its trace_data slot if it has one */
+#define TRACE_MAGIC   "SIMT"
+#define TRACE_VERSION 5
+
+struct trace_header {
+  char magic[4];
+  int version;
+  int recsize;              /* sizeof(struct trace_record) and of trace_data */
+};
+
+#define TRACE_ON(s, level) (TRACE_BUILD >= (level) && (s)->trace >= (level))
+
+#define TRACE(s, level, code, entity) \
+  do { if (TRACE_ON(s, level)) trace_point(s, code, entity, NULL, 0.0, NULL, 0, 0); } while (0)
+#define TRACE_PKT(s, level, code, entity, pkt) \
+  do { if (TRACE_ON(s, level)) trace_point(s, code, entity, pkt, 0.0, NULL, 0, 0); } while (0)
+#define TRACE_VALUE(s, level, code, entity, value) \
+  do { if (TRACE_ON(s, level)) trace_point(s, code, entity, NULL, value, NULL, 0, 0); } while (0)
+#define TRACE_DATA(s, level, code, entity, data, length) \
+  do { if (TRACE_ON(s, level)) trace_point(s, code, entity, NULL, 0.0, data, length, 0); } while (0)
+#define TRACE_EVENT(s, level, ev) \
+  do { if (TRACE_ON(s, level)) \
+         trace_point(s, TR_EVENT, (ev)->eventity, NULL, (ev)->evtime, NULL, 0, (ev)->evtype); } while (0)
+
+/* record one trace point; use the TRACE* macros rather than this */
+extern void trace_point(struct sim *, int code, int entity, const struct pkt *,
+                        double value, const char *data, int length, int type);
+
+/* collect the trace of a simulation in a binary file rather than
+   printing it, returns 0 on success */
+extern int trace_open(struct sim *, const char *path);
+
+/* write out the records still in memory and close the file */
+extern void trace_close(struct sim *);
+
+/* print a record, with its data or NULL, as the text the emulator
+   prints for it */
+extern void trace_render(FILE *, const struct trace_record *, const struct trace_data *);
+
+#endif
@@ -0,0 +1,53 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "trace.h"
+
+/* ******************************************************************
+   Print a binary trace file written with --trace-file as the text
+   the emulator would have printed while running.
+
+     gcc -Wall tracedump.c trace.c -o tracedump
+     ./tracedump run.trace [level]
+
+   With a level, only the trace points the emulator prints at that
+   TRACE level are shown.
+**********************************************************************/
+
+int main(int argc, char **argv)
+{
+  struct trace_header h;
+  struct trace_record r;
+  struct trace_data d;
+  FILE *f;
+  int level = -1;
+
+  if (argc < 2 || argc > 3) {
+    printf("usage: %s tracefile [level]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (argc == 3)
+    level = atoi(argv[2]);
+  if ((f = fopen(argv[1], "rb")) == NULL) {
+    printf("cannot open trace file %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  if (fread(&h, sizeof(h), 1, f) != 1 || memcmp(h.magic, TRACE_MAGIC, sizeof(h.magic)) != 0) {
+    printf("%s is not a trace file\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  if (h.version != TRACE_VERSION || h.recsize != (int)sizeof(r)) {
+    printf("%s was written by a different version of the emulator\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  while (fread(&r, sizeof(r), 1, f) == 1) {
+    if ((r.flags & TRF_DATA) && fread(&d, sizeof(d), 1, f) != 1) {
+      printf("%s is cut off\n", argv[1]);
+      return EXIT_FAILURE;
+    }
+    if (level < 0 || (r.code < TR_NCODES && trace_levels[r.code] <= level))
+      trace_render(stdout, &r, (r.flags & TRF_DATA) ? &d : NULL);
+  }
+  fclose(f);
+  return EXIT_SUCCESS;
+}